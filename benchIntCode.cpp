@@ -0,0 +1,636 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <map>
+#include <utility>
+#include <algorithm>
+#include <cstdio>
+
+#include "./src/intCode.hpp"
+#include "./src/lockstep.hpp"
+#include "./src/generator.hpp"
+#include "./src/trace.hpp"
+#include "./src/scheduler.hpp"
+#include "./src/threadedScheduler.hpp"
+#include "./src/batchRunner.hpp"
+#include "./src/specializer.hpp"
+#include "./src/inverseSolver.hpp"
+#include "./src/programLoader.hpp"
+
+
+// Benchmarks the instruction loops of intCode<T, D> on the day 9 (BOOST,
+// part 2) and day 13 (arcade, part 2) programs, recording day 9 with
+// trace<T, D> against running it on channels, the superinstructions of the
+// compiled backend (on and off) on the day 9, 11 (painting robot), 13 and 15
+// (repair droid) programs, re-entering runIntCode() against a generator on
+// the days 11 and 15, intCode against the lanes of lockstep<T, K> and
+// the specialized program (residual, closed form, inverse solver) on the day
+// 2 noun/verb search, the same search on batchRunner with 1, 2, 4, ... threads
+// (one batch, and one batch per noun), a ring of relay machines on the scheduler against a
+// thread per machine (threadedScheduler) and next to a machine computing
+// without input or output under several scheduler quanta, and the startup
+// of a machine from text against a binary image (day 13 and a day 9 program
+// padded to 2^20 integers).
+
+
+// every run*() optionally turns superinstructions on and hands out the
+// profile of the machine (P = profiler)
+
+template<typename D, typename P = noProfiler>
+long runBoost(const std::vector<long> & initCode, bool fusion = false,
+              P * profile = nullptr)
+{
+    intCode<long, D, P> IC(initCode);
+    IC.setFusion(fusion);
+    IC.runIntCode(2L);
+
+    if (profile) { *profile = IC.getProfile(); }
+    return IC.getSingleOutput();
+}
+
+
+template<typename D>
+long runBoostChannels(const std::vector<long> & initCode)
+{
+    // same as runBoost() on channels, the way trace<T, D> drives a machine
+    intCode<long, D> IC(initCode);
+    channel<long> in(1);
+    channel<long> out(256);
+    in.push(2);
+    IC.runIntCode(in, out);
+
+    return out.front();
+}
+
+
+template<typename D>
+long runBoostTraced(const std::vector<long> & initCode, size_t interval)
+{
+    // same as runBoost() recorded with a checkpoint every interval
+    // instructions
+    trace<long, D> rec(intCode<long, D>(initCode), interval);
+    rec.push(2);
+    rec.run();
+
+    return rec.getOutputs()[0];
+}
+
+
+template<typename D, typename P = noProfiler>
+long runArcade(const std::vector<long> & initCode, bool fusion = false,
+               P * profile = nullptr)
+{
+    // plays the game with the paddle following the ball, returns final score
+    std::vector<long> modCode(initCode);
+    modCode[0] = 2;
+
+    intCode<long, D, P> IC(modCode, false, true, false);
+    IC.setFusion(fusion);
+
+    long input = 0;
+    long paddle = 0;
+    long ball = 0;
+    long score = 0;
+    bool halted = IC.runIntCode();
+
+    while (true) {
+        std::vector<long> output = IC.getOutput();
+        for (size_t i = 0; i < output.size(); i+=3) {
+            if (output[i] == -1 && output[i+1] == 0) {
+                score = output[i+2];
+            } else if (output[i+2] == 3) {
+                paddle = output[i];
+            } else if (output[i+2] == 4) {
+                ball = output[i];
+            }
+        }
+
+        if (halted) { break; }
+
+        input = (paddle < ball) - (paddle > ball);
+        halted = IC.runIntCode(input);
+    }
+
+    if (profile) { *profile = IC.getProfile(); }
+    return score;
+}
+
+
+template<typename D, typename P = noProfiler>
+long runRobot(const std::vector<long> & initCode, bool fusion = false,
+              P * profile = nullptr)
+{
+    // paints the hull starting on a black panel, returns the number of
+    // panels painted at least once
+    intCode<long, D, P> IC(initCode, false, true, false);
+    IC.setFusion(fusion);
+
+    std::map<std::pair<long, long>, long> hull;
+    long x = 0;
+    long y = 0;
+    int dir = 0; // 0 up, 1 right, 2 down, 3 left
+    bool halted = false;
+
+    while (!halted) {
+        auto panel = hull.find({x, y});
+        halted = IC.runIntCode(panel == hull.end() ? 0L : panel->second);
+
+        std::vector<long> output = IC.getOutput();
+        if (output.size() < 2) { break; }
+
+        hull[{x, y}] = output[0];
+        dir = (dir + (output[1] == 1 ? 1 : 3)) % 4;
+        x += (dir == 1) - (dir == 3);
+        y += (dir == 0) - (dir == 2);
+    }
+
+    if (profile) { *profile = IC.getProfile(); }
+    return hull.size();
+}
+
+
+template<typename D, typename P = noProfiler>
+long runDroid(const std::vector<long> & initCode, bool fusion = false,
+              P * profile = nullptr)
+{
+    // follows the wall on the right until the droid is back at the start,
+    // returns the number of moves
+    intCode<long, D, P> IC(initCode, true, true, false);
+    IC.setFusion(fusion);
+
+    static const long left[] = {0, 3, 4, 2, 1}; // by direction 1..4
+    static const long right[] = {0, 4, 3, 1, 2};
+    static const long dx[] = {0, 0, 0, -1, 1};
+    static const long dy[] = {0, 1, -1, 0, 0};
+
+    long x = 0;
+    long y = 0;
+    long input = 1;
+    long moves = 0;
+
+    while (!IC.runIntCode(input)) {
+        long output = IC.getSingleOutput();
+        moves++;
+
+        if (output == 0) {
+            input = left[input];
+        } else {
+            x += dx[input];
+            y += dy[input];
+            if (x == 0 && y == 0) { break; }
+            input = right[input];
+        }
+    }
+
+    if (profile) { *profile = IC.getProfile(); }
+    return moves;
+}
+
+
+template<typename D>
+long runRobotGenerator(const std::vector<long> & initCode)
+{
+    // same as runRobot() pulling the outputs from a generator
+    generator<long, D> robot(initCode);
+
+    std::map<std::pair<long, long>, long> hull;
+    long x = 0;
+    long y = 0;
+    int dir = 0;
+    long color, turn;
+
+    robot.send(0);
+    while (robot.next(color) && robot.next(turn)) {
+        hull[{x, y}] = color;
+        dir = (dir + (turn == 1 ? 1 : 3)) % 4;
+        x += (dir == 1) - (dir == 3);
+        y += (dir == 0) - (dir == 2);
+
+        auto panel = hull.find({x, y});
+        robot.send(panel == hull.end() ? 0L : panel->second);
+    }
+
+    return hull.size();
+}
+
+
+template<typename D>
+long runDroidGenerator(const std::vector<long> & initCode)
+{
+    // same as runDroid() pulling the outputs from a generator
+    generator<long, D> droid(initCode);
+
+    static const long left[] = {0, 3, 4, 2, 1};
+    static const long right[] = {0, 4, 3, 1, 2};
+    static const long dx[] = {0, 0, 0, -1, 1};
+    static const long dy[] = {0, 1, -1, 0, 0};
+
+    long x = 0;
+    long y = 0;
+    long input = 1;
+    long moves = 0;
+    long output;
+
+    while (droid.send(input) && droid.next(output)) {
+        moves++;
+
+        if (output == 0) {
+            input = left[input];
+        } else {
+            x += dx[input];
+            y += dy[input];
+            if (x == 0 && y == 0) { break; }
+            input = right[input];
+        }
+    }
+
+    return moves;
+}
+
+
+long searchSerial(const std::vector<long> & initCode)
+{
+    // all noun/verb pairs of day 2, returns 100*noun+verb of the pair giving
+    // 19690720 at position 0
+    const intCode<long> proto(initCode);
+    long res = 0;
+    for (long noun = 0; noun < 100; noun++) {
+        for (long verb = 0; verb < 100; verb++) {
+            intCode<long> IC = proto.fork();
+            IC.patch(1, noun);
+            IC.patch(2, verb);
+            IC.runIntCode();
+            if (IC.getMemory(0) == 19690720) { res = 100*noun+verb; }
+        }
+    }
+
+    return res;
+}
+
+
+long searchResidual(const std::vector<long> & initCode)
+{
+    // same as searchSerial() on the residual program of initCode specialized
+    // to unknown noun and verb (specialization included)
+    specializer<long> spec(initCode, {1, 2}, {}, std::vector<size_t>{0});
+    const intCode<long> proto(spec.getResidual(), false, false, false,
+                              spec.getEntry());
+    long res = 0;
+    for (long noun = 0; noun < 100; noun++) {
+        for (long verb = 0; verb < 100; verb++) {
+            intCode<long> IC = proto.fork();
+            IC.patch(1, noun);
+            IC.patch(2, verb);
+            IC.runIntCode();
+            if (IC.getMemory(0) == 19690720) { res = 100*noun+verb; }
+        }
+    }
+
+    return res;
+}
+
+
+long searchClosedForm(const std::vector<long> & initCode)
+{
+    // same as searchSerial() evaluating the closed form of position 0
+    specializer<long> spec(initCode, {1, 2});
+    long res = 0;
+    for (long noun = 0; noun < 100; noun++) {
+        for (long verb = 0; verb < 100; verb++) {
+            if (spec.evaluate(0, {noun, verb}) == 19690720) {
+                res = 100*noun+verb;
+            }
+        }
+    }
+
+    return res;
+}
+
+
+long searchSolver(const std::vector<long> & initCode)
+{
+    // same as searchSerial() solved on the closed form, see inverseSolver.hpp
+    inverseSolver<long> solver(initCode, {1, 2}, {{0, 99}, {0, 99}});
+    std::vector<std::vector<long>> res = solver.solveCell(0, 19690720);
+
+    return res.empty() ? 0 : 100*res[0][0] + res[0][1];
+}
+
+
+template<size_t K>
+long searchLanes(const std::vector<long> & initCode)
+{
+    // same as searchSerial() with K pairs per lockstep run (copies of one
+    // prototype, like the forks of searchSerial())
+    const lockstep<long, K> proto(initCode);
+    long res = 0;
+    for (long first = 0; first < 10000; first += K) {
+        lockstep<long, K> lanes(proto);
+        for (size_t l = 0; l < K; l++) {
+            lanes.patch(l, 1, (first+l) / 100 % 100);
+            lanes.patch(l, 2, (first+l) % 100);
+        }
+        lanes.run();
+        for (size_t l = 0; l < K && first+long(l) < 10000; l++) {
+            if (lanes.getMemory(l, 0) == 19690720) { res = first+l; }
+        }
+    }
+
+    return res;
+}
+
+
+long searchBatch(batchRunner<long> & runner, size_t batches)
+{
+    // same as searchSerial() as batches of jobs on one runner (its workers
+    // stay alive from one batch to the next)
+    long res = 0;
+    for (size_t b = 0; b < batches; b++) {
+        std::vector<batchRunner<long>::job> jobs;
+        for (long i = 10000 * b / batches; i < long(10000 * (b+1) / batches);
+             i++)
+        {
+            jobs.push_back({{{1, i / 100}, {2, i % 100}}, {}});
+        }
+
+        std::vector<batchRunner<long>::result> found = runner.run(jobs);
+        for (size_t j = 0; j < jobs.size(); j++) {
+            if (found[j].peek[0] == 19690720) {
+                res = 100 * jobs[j].patch[0].second + jobs[j].patch[1].second;
+            }
+        }
+    }
+
+    return res;
+}
+
+
+std::vector<long> relayCode(long rounds, long work)
+{
+    // reads a token, counts down from work, passes the token on incremented,
+    // rounds times, then halts
+    std::vector<long> code{
+        3, 100,                     //  0: [100] = input
+        1101, 0, work, 101,         //  2: [101] = work
+        1001, 101, -1, 101,         //  6: [101] -= 1
+        1005, 101, 6,               // 10: loop while [101] != 0
+        1001, 100, 1, 100,          // 13: [100] += 1
+        4, 100,                     // 17: output [100]
+        1001, 102, -1, 102,         // 19: [102] -= 1
+        1005, 102, 0,               // 23: next round while [102] != 0
+        99};                        // 26
+    code.resize(103, 0);
+    code[102] = rounds;
+
+    return code;
+}
+
+
+template<typename S>
+long runRing(const std::vector<long> & code, size_t n)
+{
+    // n relay machines in a ring (S = scheduler or threadedScheduler), one
+    // token per machine, returns the sum of the tokens
+    S ring(4);
+    const intCode<long> proto(code);
+    for (size_t m = 0; m < n; m++) {
+        ring.addMachine(proto.fork());
+    }
+    for (size_t m = 0; m < n; m++) {
+        ring.connect(m, (m+1) % n);
+        ring.push(m, m);
+    }
+    ring.run();
+
+    long sum = 0;
+    for (size_t m = 0; m < n; m++) {
+        sum += ring.getMachine(m).getMemory(100);
+    }
+
+    return sum;
+}
+
+
+long runHogged(const std::vector<long> & code, long hog, size_t quantum)
+{
+    // a ring of 5 relay machines next to a machine counting down from hog
+    // without any input or output, returns the longest wait of a ready
+    // machine (in instructions, see scheduler::getMaxLatency())
+    std::vector<long> hogCode{
+        1101, 0, hog, 100,          //  0: [100] = hog
+        1001, 100, -1, 100,         //  4: [100] -= 1
+        1005, 100, 4,               //  8: loop while [100] != 0
+        99};                        // 11
+    hogCode.resize(101, 0);
+
+    scheduler<long> net(4, quantum);
+    net.addMachine(intCode<long>(hogCode));
+    for (size_t m = 1; m <= 5; m++) {
+        net.addMachine(intCode<long>(code));
+    }
+    for (size_t m = 1; m <= 5; m++) {
+        net.connect(m, m % 5 + 1);
+        net.push(m, m);
+    }
+    net.run();
+
+    return net.getMaxLatency();
+}
+
+
+long startText(const std::string & path)
+{
+    // parses the program and constructs a machine, returns its first integer
+    intCode<long> IC(loadProgram<long>(path));
+
+    return IC.getMemory(0);
+}
+
+
+long startImage(const std::string & path)
+{
+    // same as startText() from a binary image (mapped, not copied)
+    intCode<long> IC(intCodeImage<long>::load(path));
+
+    return IC.getMemory(0);
+}
+
+
+template<typename F>
+void timeIt(const std::string & name, unsigned reps, F f)
+{
+    long res = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < reps; i++) {
+        res = f();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double ms = std::chrono::duration<double, std::milli>(end - start).count();
+    std::cout << name << ": " << ms / reps << " ms per run (result "
+              << res << ")\n";
+}
+
+
+template<typename F>
+void timeFusion(const std::string & name, unsigned reps, F f)
+{
+    // hit rate from a profiled run, then the best time of reps runs without
+    // and with superinstructions (alternating, the difference is small
+    // compared to the noise of a single run)
+    profiler profile;
+    f(true, &profile);
+    size_t total = 0;
+    for (int op = 0; op < 100; op++) { total += profile.getOpcodeCount(op); }
+
+    double ms[2] = {1e9, 1e9};
+    for (unsigned i = 0; i < reps; i++) {
+        for (int fusion = 0; fusion < 2; fusion++) {
+            auto start = std::chrono::steady_clock::now();
+            f(fusion == 1, static_cast<noProfiler *>(nullptr));
+            auto end = std::chrono::steady_clock::now();
+            ms[fusion] = std::min(ms[fusion],
+                std::chrono::duration<double, std::milli>(end - start).count());
+        }
+    }
+
+    std::cout << name << ": " << 100.0 * profile.getFusedCount() / total
+              << "% of " << total << " instructions fused ("
+              << double(profile.getFusedCount()) /
+                 profile.getSuperinstructionCount()
+              << " per superinstruction), " << ms[0] << " ms -> " << ms[1]
+              << " ms (" << ms[0] / ms[1] << "x)\n";
+}
+
+
+// ############
+// --- MAIN ---
+// ############
+
+int main() {
+    std::vector<long> boostCode = loadProgram<long>("./input_files/in09.txt");
+    std::vector<long> arcadeCode = loadProgram<long>("./input_files/in13.txt");
+    std::vector<long> gravityCode = loadProgram<long>("./input_files/in02.txt");
+    std::vector<long> robotCode = loadProgram<long>("./input_files/in11.txt");
+    std::vector<long> droidCode = loadProgram<long>("./input_files/in15.txt");
+
+    const unsigned reps = 20;
+
+    std::cout << "\n - - - DAY 9 (BOOST) - - -\n";
+    timeIt("switch  ", reps, [&]{ return runBoost<switchDispatch>(boostCode); });
+    timeIt("threaded", reps, [&]{ return runBoost<threadedDispatch>(boostCode); });
+    timeIt("compiled", reps, [&]{ return runBoost<compiledDispatch>(boostCode); });
+
+    std::cout << "\n - - - DAY 9 (trace off -> on) - - -\n";
+    timeIt("switch   off      ", reps, [&]{
+        return runBoostChannels<switchDispatch>(boostCode); });
+    timeIt("switch   on, 2^16 ", reps, [&]{
+        return runBoostTraced<switchDispatch>(boostCode, 1 << 16); });
+    timeIt("switch   on, 2^12 ", reps, [&]{
+        return runBoostTraced<switchDispatch>(boostCode, 1 << 12); });
+    timeIt("compiled off      ", reps, [&]{
+        return runBoostChannels<compiledDispatch>(boostCode); });
+    timeIt("compiled on, 2^16 ", reps, [&]{
+        return runBoostTraced<compiledDispatch>(boostCode, 1 << 16); });
+    timeIt("compiled on, 2^12 ", reps, [&]{
+        return runBoostTraced<compiledDispatch>(boostCode, 1 << 12); });
+
+    std::cout << "\n - - - DAY 13 (ARCADE) - - -\n";
+    timeIt("switch  ", reps, [&]{ return runArcade<switchDispatch>(arcadeCode); });
+    timeIt("threaded", reps, [&]{ return runArcade<threadedDispatch>(arcadeCode); });
+    timeIt("compiled", reps, [&]{ return runArcade<compiledDispatch>(arcadeCode); });
+
+    std::cout << "\n - - - SUPERINSTRUCTIONS (compiled, off -> on, best of "
+              << 5*reps << ") - - -\n";
+    timeFusion("day  9", 5*reps, [&](bool fusion, auto * profile) {
+        return runBoost<compiledDispatch>(boostCode, fusion, profile); });
+    timeFusion("day 11", 5*reps, [&](bool fusion, auto * profile) {
+        return runRobot<compiledDispatch>(robotCode, fusion, profile); });
+    timeFusion("day 13", 5*reps, [&](bool fusion, auto * profile) {
+        return runArcade<compiledDispatch>(arcadeCode, fusion, profile); });
+    timeFusion("day 15", 5*reps, [&](bool fusion, auto * profile) {
+        return runDroid<compiledDispatch>(droidCode, fusion, profile); });
+
+    std::cout << "\n - - - RESUME (runIntCode -> generator) - - -\n";
+    timeIt("day 11 runIntCode", reps, [&]{
+        return runRobot<switchDispatch>(robotCode); });
+    timeIt("day 11 generator ", reps, [&]{
+        return runRobotGenerator<switchDispatch>(robotCode); });
+    timeIt("day 15 runIntCode", reps, [&]{
+        return runDroid<switchDispatch>(droidCode); });
+    timeIt("day 15 generator ", reps, [&]{
+        return runDroidGenerator<switchDispatch>(droidCode); });
+
+    std::cout << "\n - - - DAY 2 (NOUN/VERB SEARCH) - - -\n";
+    timeIt("intCode ", reps, [&]{ return searchSerial(gravityCode); });
+    timeIt("4 lanes ", reps, [&]{ return searchLanes<4>(gravityCode); });
+    timeIt("8 lanes ", reps, [&]{ return searchLanes<8>(gravityCode); });
+    timeIt("16 lanes", reps, [&]{ return searchLanes<16>(gravityCode); });
+    timeIt("residual", reps, [&]{ return searchResidual(gravityCode); });
+    timeIt("closed  ", reps, [&]{ return searchClosedForm(gravityCode); });
+    timeIt("solver  ", reps, [&]{ return searchSolver(gravityCode); });
+
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    std::cout << "\n - - - DAY 2 (batchRunner, 1 batch -> 100 batches, "
+              << cores << " cores) - - -\n";
+    for (unsigned t = 1; ; t = std::min(2*t, cores)) {
+        batchRunner<long> runner(gravityCode, {0}, t);
+        std::string threads = std::to_string(t) + " thread" +
+                              (t > 1 ? "s" : "");
+        threads.resize(11, ' ');
+        timeIt(threads + "1  ", reps, [&]{ return searchBatch(runner, 1); });
+        timeIt(threads + "100", reps, [&]{ return searchBatch(runner, 100); });
+        if (t == cores) { break; }
+    }
+
+    std::cout << "\n - - - RING (scheduler -> thread per machine, "
+              << std::thread::hardware_concurrency() << " cores) - - -\n";
+    std::vector<long> relay = relayCode(20, 1000);
+    for (size_t n: {5, 64, 1024}) {
+        unsigned r = n < 1000 ? reps : 2;
+        std::string size = std::to_string(n);
+        size.resize(4, ' ');
+        timeIt(size + " scheduler", r, [&]{
+            return runRing<scheduler<long>>(relay, n); });
+        timeIt(size + " threads  ", r, [&]{
+            return runRing<threadedScheduler<long>>(relay, n); });
+    }
+
+    std::cout << "\n - - - QUANTUM (ring next to a busy machine, result: "
+              << "longest wait) - - -\n";
+    std::vector<long> hopCode = relayCode(20, 100);
+    timeIt("no limit", reps, [&]{
+        return runHogged(hopCode, 1000000, size_t(-1)); });
+    timeIt("10000   ", reps, [&]{
+        return runHogged(hopCode, 1000000, 10000); });
+    timeIt("1000    ", reps, [&]{
+        return runHogged(hopCode, 1000000, 1000); });
+    timeIt("100     ", reps, [&]{
+        return runHogged(hopCode, 1000000, 100); });
+
+    std::vector<long> largeCode(boostCode);
+    largeCode.resize(1 << 20, 0);
+    std::ofstream largeText("bench_large.txt");
+    for (size_t i = 0; i < largeCode.size(); i++) {
+        largeText << (i ? "," : "") << largeCode[i];
+    }
+    largeText.close();
+    intCodeImage<long>::save("bench_arcade.icim", arcadeCode);
+    intCodeImage<long>::save("bench_large.icim", largeCode);
+
+    std::cout << "\n - - - STARTUP (text -> image) - - -\n";
+    timeIt("day 13 text ", reps, [&]{
+        return startText("./input_files/in13.txt"); });
+    timeIt("day 13 image", reps, [&]{
+        return startImage("bench_arcade.icim"); });
+    timeIt("2^20   text ", 1, [&]{ return startText("bench_large.txt"); });
+    timeIt("2^20   image", reps, [&]{
+        return startImage("bench_large.icim"); });
+
+    std::remove("bench_large.txt");
+    std::remove("bench_arcade.icim");
+    std::remove("bench_large.icim");
+}
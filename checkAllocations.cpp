@@ -0,0 +1,113 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <new>
+#include <cstdlib>
+#include <atomic>
+
+#include "./src/intCode.hpp"
+#include "./src/programLoader.hpp"
+
+
+/*
+Checks intCode::getAllocationCount() against the heap allocations actually
+done: the global operator new is replaced by one counting every call, the
+day 9 program (BOOST, parts 1 and 2) runs under every dispatch policy and
+the count reported by the machine must equal the allocations counted while
+runIntCode() ran. The run is repeated on channels in two halves (see
+intCode::run()): the second half must not allocate at all with
+switchDispatch and threadedDispatch, by then every page was touched and the
+instruction loop itself never allocates (with compiledDispatch, code first
+reached in the second half is still translated).
+
+The counts themselves are not fixed: compiledDispatch grows vectors of
+micro-ops, whose growth steps depend on the standard library, and fewer
+blocks are translated with superinstructions on (see setFusion()). Only
+the match and the second half of switchDispatch and threadedDispatch are
+checked.
+
+# checkAllocations.exe
+- prints the counts per run, returns 1 if any check fails
+*/
+
+
+static std::atomic<size_t> allocations(0);
+
+// not inlined, so that the compiler does not pair the malloc() and free()
+// behind them with the allocations of the standard library
+__attribute__((noinline)) void * operator new(size_t n) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void * p = std::malloc(n ? n : 1)) { return p; }
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void * p) noexcept {
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete(void * p, size_t) noexcept {
+    std::free(p);
+}
+
+
+template<typename D>
+bool check(const std::string & name, const std::vector<long> & code, long in)
+{
+    // runs code with input in twice: at once, then on channels in two
+    // halves. Returns false if a count does not match
+    // -----------------
+
+    bool ok = true;
+
+    intCode<long, D> whole(code);
+    size_t before = allocations.load();
+    whole.runIntCode(in);
+    size_t counted = allocations.load() - before;
+    size_t reported = whole.getAllocationCount();
+    size_t total = whole.getInstructionCount();
+
+    std::cout << name << " input " << in << ": " << counted
+              << " allocations, " << reported << " reported";
+    if (counted != reported) { ok = false; }
+
+    intCode<long, D> halves(code);
+    channel<long> input(4);
+    channel<long> output(64);
+    input.push(in);
+    halves.run(input, output, total / 2);
+    size_t first = halves.getAllocationCount();
+    before = allocations.load();
+    halves.run(input, output, size_t(-1));
+    counted = allocations.load() - before;
+    reported = halves.getAllocationCount() - first;
+
+    std::cout << ", second half " << counted << " (" << reported
+              << " reported)";
+    if (counted != reported) { ok = false; }
+    if (!std::is_same<D, compiledDispatch>::value && counted != 0) {
+        ok = false;
+    }
+
+    std::cout << (ok ? "\n" : "  <-- FAILED\n");
+    return ok;
+}
+
+
+// ############
+// --- MAIN ---
+// ############
+
+int main() {
+    std::vector<long> code = loadProgram<long>("./input_files/in09.txt");
+
+    bool ok = true;
+    for (long in: {1L, 2L}) {
+        ok = check<switchDispatch>("switch  ", code, in) && ok;
+        ok = check<threadedDispatch>("threaded", code, in) && ok;
+        ok = check<compiledDispatch>("compiled", code, in) && ok;
+    }
+
+    std::cout << (ok ? "all allocation counts match\n"
+                     : "allocation counts do not match\n");
+    return ok ? 0 : 1;
+}
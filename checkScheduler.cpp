@@ -0,0 +1,76 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "./src/intCode.hpp"
+#include "./src/scheduler.hpp"
+#include "./src/threadedScheduler.hpp"
+
+
+/*
+Checks that scheduler<T, D> (see scheduler.hpp, with and without a quantum)
+and threadedScheduler<T, D> handle machines with an instruction limit of
+their own (intCode::setInstructionLimit()): run() stops with LIMITED once
+the limited machine stands at its limit (not IDLE, not spinning on it) and
+finishes the network after setInstructionLimit() of the scheduler raised
+it.
+
+# checkScheduler.exe
+- prints one line per check, returns 1 if any check fails
+*/
+
+
+bool report(const std::string & name, bool ok) {
+    std::cout << name << (ok ? "\n" : "  <-- FAILED\n");
+    return ok;
+}
+
+
+template<typename S>
+bool check(S & net) {
+    // machine 0 counts down from 1000 (2003 instructions), outputs 42 and
+    // halts, machine 1 passes its input on. Machine 0 may run 105
+    // instructions at first
+
+    std::vector<long> countdown{1101, 1000, 0, 20, 1001, 20, -1, 20,
+                                1005, 20, 4, 104, 42, 99};
+    std::vector<long> relay{3, 20, 4, 20, 99};
+
+    intCode<long> limited(countdown);
+    limited.setInstructionLimit(105);
+    net.addMachine(limited);
+    net.addMachine(intCode<long>(relay));
+    net.connect(0, 1);
+
+    bool ok = net.run() == S::LIMITED && net.isLimited(0) &&
+              net.getInstructionCount(0) == 105;
+
+    net.setInstructionLimit(0, size_t(-1));
+    ok = ok && !net.isLimited(0) && net.run() == S::HALTED &&
+         net.getInstructionCount(0) == 2003;
+
+    std::vector<long> out;
+    net.drain(1, [&](long val) { out.push_back(val); });
+    return ok && out == std::vector<long>{42};
+}
+
+
+// ############
+// --- MAIN ---
+// ############
+
+int main() {
+    bool ok = true;
+    scheduler<long> whole(64);
+    ok = report("scheduler, no quantum", check(whole)) && ok;
+    scheduler<long> sliced(64, 10);
+    ok = report("scheduler, quantum 10", check(sliced)) && ok;
+    scheduler<long> exact(64, 105);
+    ok = report("scheduler, quantum 105", check(exact)) && ok;
+    threadedScheduler<long> threads(64);
+    ok = report("threadedScheduler", check(threads)) && ok;
+
+    std::cout << (ok ? "all scheduler checks pass\n"
+                     : "scheduler checks fail\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,120 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+#include "./src/intCode.hpp"
+#include "./src/specializer.hpp"
+#include "./src/programLoader.hpp"
+
+
+/*
+Checks that residual programs of specializer<T> (see specializer.hpp) behave
+like the original program:
+- a specialization that stops early has no residual program (the original
+  program would continue with the scratch cells and the residual code in
+  memory, where it reads zeros otherwise)
+- a load through an unknown pointer at or above the scratch cells reads 0
+- the residual programs of the day 2 (noun/verb unknown) and day 7 (phase
+  known, signal unknown) programs give the outputs and final memory of the
+  original program
+
+# checkSpecializer.exe
+- prints one line per check, returns 1 if any check fails
+*/
+
+
+bool report(const std::string & name, bool ok) {
+    std::cout << name << (ok ? "\n" : "  <-- FAILED\n");
+    return ok;
+}
+
+
+bool sameRun(const std::vector<long> & code, const specializer<long> & spec,
+             const std::vector<std::pair<size_t, long>> & patch,
+             const std::vector<long> & inputs, size_t watch)
+{
+    // runs code and the residual of spec with the same patches and inputs,
+    // true if the outputs and the first watch cells agree
+
+    intCode<long> orig(code);
+    intCode<long> res(spec.getResidual(), false, false, false,
+                      spec.getEntry());
+    for (const auto & p: patch) {
+        orig.patch(p.first, p.second);
+        res.patch(p.first, p.second);
+    }
+    orig.runIntCode(inputs);
+    res.runIntCode(inputs);
+
+    bool same = orig.getOutput() == res.getOutput();
+    for (size_t addr = 0; same && addr < watch; addr++) {
+        same = orig.getMemory(addr) == res.getMemory(addr);
+    }
+
+    return same;
+}
+
+
+// ############
+// --- MAIN ---
+// ############
+
+int main() {
+    bool ok = true;
+
+    // reads an input and jumps on it: stops at position 2. Scratch cell 0
+    // would be address 21, which the program outputs
+    std::vector<long> early{3, 20, 1005, 20, 7, 99, 99, 4, 21, 99};
+    early.resize(21, 0);
+    specializer<long> stopped(early, {}, {});
+    bool thrown = false;
+    try {
+        stopped.getResidual();
+    } catch (const std::runtime_error &) {
+        thrown = true;
+    }
+    ok = report("incomplete: no residual program", !stopped.isComplete() &&
+                stopped.getStopPosition() == 2 && thrown) && ok;
+
+    // outputs the cell the unknown address 1 points to, 3 is the first
+    // scratch cell (the copy of address 1)
+    std::vector<long> deref{4, 0, 99};
+    specializer<long> pointer(deref, {1});
+    bool zeros = pointer.isComplete();
+    for (long ptr: {0L, 1L, 2L, 3L, 4L, 5L, 8L, 100L}) {
+        zeros = zeros && sameRun(deref, pointer, {{1, ptr}}, {}, 3);
+    }
+    ok = report("loads beyond the program read 0", zeros) && ok;
+
+    std::vector<long> gravity = loadProgram<long>("./input_files/in02.txt");
+    specializer<long> nounVerb(gravity, {1, 2});
+    bool day2 = nounVerb.isComplete();
+    for (long noun = 0; noun < 100; noun += 7) {
+        for (long verb = 0; verb < 100; verb += 11) {
+            day2 = day2 && sameRun(gravity, nounVerb, {{1, noun}, {2, verb}},
+                                   {}, gravity.size());
+        }
+    }
+    ok = report("day 2 residual", day2) && ok;
+
+    std::vector<long> amp = loadProgram<long>("./input_files/in07.txt");
+    bool day7 = true;
+    for (long phase = 0; phase < 5; phase++) {
+        specializer<long> spec(amp, {}, {phase});
+        day7 = day7 && spec.isComplete();
+        for (long signal: {0L, 1L, 17L, 12345L}) {
+            intCode<long> orig(amp);
+            orig.runIntCode(std::vector<long>{phase, signal});
+            intCode<long> res(spec.getResidual(), false, false, false,
+                              spec.getEntry());
+            res.runIntCode(signal);
+            day7 = day7 && orig.getOutput() == res.getOutput();
+        }
+    }
+    ok = report("day 7 residual", day7) && ok;
+
+    std::cout << (ok ? "all residual programs match\n"
+                     : "residual programs do not match\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,66 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include "./src/disassembler.hpp"
+#include "./src/programLoader.hpp"
+
+
+/*
+Disassembles an Intcode program, see src/disassembler.hpp.
+
+# intCodeDisasm.exe [-l] PROGRAM ...
+- Arguments:
+    PROGRAM - comma separated int code, e.g. input_files/in09.txt
+    -l - print the listing (instructions grouped into basic blocks) in
+         addition to the summary
+*/
+
+
+int main(int argc, char ** argv) {
+    bool listing = false;
+    std::vector<std::string> args;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        if (arg == "-l") { listing = true; }
+        else { args.push_back(arg); }
+    }
+
+    if (args.empty()) {
+        std::cerr << "usage: intCodeDisasm.exe [-l] PROGRAM ...\n";
+        return 1;
+    }
+
+    for (const std::string & path: args) {
+        std::vector<long long> code;
+        try {
+            code = loadProgram<long long>(path);
+        } catch (const std::runtime_error & e) {
+            std::cerr << e.what() << "\n";
+            return 1;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        disassembler<long long> dis(code);
+        auto end = std::chrono::steady_clock::now();
+
+        size_t cells = 0;
+        for (size_t p = 0; p < code.size(); p++) { cells += dis.isCode(p); }
+        size_t indirect = 0;
+        for (const auto & b: dis.getBlocks()) { indirect += b.indirect; }
+
+        std::cout << path << ": " << dis.getInstructions().size()
+                  << " instructions (" << cells << " of " << code.size()
+                  << " integers), " << dis.getBlocks().size() << " blocks ("
+                  << indirect << " ending in an indirect jump), "
+                  << dis.getSelfModifyingWrites().size()
+                  << " self-modifying writes, "
+                  << std::chrono::duration<double, std::milli>(
+                         end - start).count() << " ms\n";
+
+        if (listing) { dis.print(std::cout); }
+    }
+}
@@ -0,0 +1,456 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <set>
+#include <stdexcept>
+
+#include "./src/disassembler.hpp"
+#include "./src/programLoader.hpp"
+
+
+/*
+Ahead-of-time translation of a fixed Intcode program into C++.
+
+# intCodeToCpp.exe [-t TYPE] [-p ADDR=VALUE ...] PROGRAM CLASS OUT
+- Arguments:
+    PROGRAM - comma separated int code, e.g. input_files/in09.txt
+    CLASS - name of the generated class
+    OUT - OUT.hpp and OUT.cpp are written
+    -t TYPE - integer type of the code (int, long (default), long long)
+    -p ADDR=VALUE - patches the program before translation (e.g. day 13
+                    inserts quarters with -p 0=2)
+
+The generated class has the same interface as intCode<TYPE> (constructor,
+runIntCode() overloads, getOutput(), getSingleOutput(), getPosition(),
+getCode()), so a driver can use it in place of intCode<TYPE>. It includes
+intCode.hpp, compile it with -I src.
+
+--- TRANSLATION ---
+
+- every instruction reachable from position 0 becomes a labelled piece of
+  straight-line C++ with opcode, modes and parameters resolved at translation
+  time. Reachable is decided by disassembler<long long> (see REACHABILITY
+  in src/disassembler.hpp): following the instruction flow from position 0,
+  both branches of conditional jumps, immediate jump targets and immediate
+  values moved into memory that point right behind an unconditional jump
+  (return addresses pushed before a call)
+- jumps to an immediate target are gotos, computed jumps go through a switch
+  over all translated positions
+- parameters that some translated instruction writes to with a constant
+  address (programs index arrays by patching the address of a following
+  instruction) are live: they are read from memory every time instead of
+  being resolved at translation time
+- all other integers of translated instructions are the code cells. A write
+  to a code cell (self-modifying code), a jump to a position that was not
+  translated, or a constructor call with a program whose code cells differ
+  from the translated one hand the machine state over to an embedded
+  intCode<TYPE> interpreter, which runs the program from then on
+*/
+
+
+typedef disassembler<long long>::instruction instr;
+
+
+std::set<size_t> findLiveCells(const std::vector<instr> & instructions)
+{
+    // constant addresses written by any translated instruction
+    // ---------------------
+
+    std::set<size_t> live;
+    for (const instr & ins: instructions) {
+        int out = (ins.opcode == 3) ? 0 : (ins.length == 4 ? 2 : -1);
+
+        if (out >= 0 && ins.mode[out] == 0 && ins.param[out] >= 0) {
+            live.insert(ins.param[out]);
+        } else if (out >= 0 && ins.mode[out] == 1) {
+            live.insert(ins.pos+1+out);
+        }
+    }
+
+    return live;
+}
+
+
+std::string paramValue(const std::set<size_t> & live, size_t cell,
+                       long long val)
+{
+    // the parameter itself: constant, or read from memory if live
+    if (live.count(cell)) {
+        return "mem_.read(" + std::to_string(cell) + "ULL)";
+    }
+    return std::to_string(val) + "LL";
+}
+
+
+std::string readParam(const std::set<size_t> & live, size_t cell, int mode,
+                      long long val)
+{
+    std::string v = paramValue(live, cell, val);
+    if (mode == 1) {
+        return "T(" + v + ")";
+    } else if (mode == 2) {
+        return "mem_.read(size_t(" + v + " + relBase_))";
+    }
+    return "mem_.read(size_t(" + v + "))";
+}
+
+
+bool writeParam(std::ostream & out, const std::set<size_t> & live,
+                const std::vector<char> & isCode, size_t pos, int i,
+                int mode, long long val, size_t next,
+                const std::string & value)
+{
+    // store value to parameter i of the instruction at pos, hand over to the
+    // interpreter if the store hits a code cell. Returns true if it always
+    // does
+    // ---------------------
+
+    size_t cell = pos + 1 + i;
+
+    if (mode == 2 || (mode == 0 && live.count(cell))) {
+        out << "    addr = size_t(" << paramValue(live, cell, val)
+            << (mode == 2 ? " + relBase_" : "") << ");\n";
+        out << "    *mem_.at(addr) = " << value << ";\n";
+        out << "    if (addr < IMAGE_SIZE && CODE[addr]) "
+            << "{ pos_ = " << next << "; return fallback(in, nIn); }\n";
+        return false;
+    }
+
+    size_t addr = (mode == 1) ? cell : size_t(val);
+    out << "    *mem_.at(" << addr << "ULL) = " << value << ";\n";
+    if (addr < isCode.size() && isCode[addr]) {
+        out << "    pos_ = " << next << "; return fallback(in, nIn);\n";
+        return true;
+    }
+
+    return false;
+}
+
+
+void writeHeader(std::ostream & out, const std::string & cls,
+                 const std::string & type, const std::string & source)
+{
+    out << "// generated by intCodeToCpp from " << source
+        << ", do not edit\n\n";
+    out << "#ifndef " << cls << "_HPP\n#define " << cls << "_HPP\n\n";
+    out << "#include <optional>\n\n#include \"intCode.hpp\"\n\n\n";
+
+    out << "class " << cls << " {\n"
+        << "    public:\n"
+        << "        typedef " << type << " T;\n\n"
+        << "        // Ctor, see intCode<T>\n"
+        << "        " << cls << "() = delete;\n"
+        << "        " << cls << "(std::vector<T> code, "
+        << "bool stopAtOutput = false,\n"
+        << "                bool stopAtInput = false, "
+        << "bool printInOut = false,\n"
+        << "                size_t pos = 0);\n\n"
+        << "        // Getters\n"
+        << "        size_t getPosition() const;\n"
+        << "        std::vector<T> getCode() const;\n"
+        << "        std::vector<T> getOutput() const;\n"
+        << "        T getSingleOutput() const { return getOutput()[0]; }\n\n"
+        << "        // Public Member\n"
+        << "        bool runIntCode(const std::vector<T> & in) "
+        << "{ return run(in.data(), in.size()); }\n"
+        << "        bool runIntCode(const T & in) { return run(&in, 1); }\n"
+        << "        bool runIntCode() { return run(nullptr, 0); }\n\n"
+        << "    private:\n"
+        << "        pagedMemory<T> mem_;\n"
+        << "        bool stopAtOutput_;\n"
+        << "        bool stopAtInput_;\n"
+        << "        bool printInOut_;\n"
+        << "        size_t pos_;\n"
+        << "        size_t inputCount_;\n"
+        << "        T relBase_;\n"
+        << "        std::vector<T> lastOut_;\n"
+        << "        bool stopped_;\n"
+        << "        std::optional<intCode<T>> interp_; // after hand over\n"
+        << "        std::vector<T> outPrefix_; // output before hand over\n\n"
+        << "        // Private Member\n"
+        << "        bool run(const T *, size_t);\n"
+        << "        T readInput(const T *, size_t);\n"
+        << "        bool fallback(const T *, size_t);\n"
+        << "        bool resume(const T *, size_t);\n\n"
+        << "        static const size_t IMAGE_SIZE;\n"
+        << "        static const T IMAGE[];\n"
+        << "        static const unsigned char CODE[]; // code cells\n"
+        << "};\n\n\n";
+    out << "#endif // " << cls << "_HPP\n";
+}
+
+
+void writeSource(std::ostream & out, const std::string & cls,
+                 const std::string & header, const std::string & source,
+                 const std::vector<long long> & code,
+                 const std::vector<instr> & instructions,
+                 const std::set<size_t> & starts,
+                 const std::set<size_t> & live,
+                 const std::vector<char> & isCode)
+{
+    out << "// generated by intCodeToCpp from " << source
+        << ", do not edit\n\n";
+    out << "#include \"" << header << "\"\n\n\n";
+    out << "typedef " << cls << "::T T;\n\n";
+
+    out << "const size_t " << cls << "::IMAGE_SIZE = " << code.size()
+        << ";\n\n";
+    out << "const T " << cls << "::IMAGE[] = {";
+    for (size_t i = 0; i < code.size(); i++) {
+        out << (i % 8 ? " " : "\n    ") << code[i] << "LL,";
+    }
+    out << "\n};\n\n";
+    out << "const unsigned char " << cls << "::CODE[] = {";
+    for (size_t i = 0; i < code.size(); i++) {
+        out << (i % 32 ? "" : "\n    ") << int(isCode[i]) << ",";
+    }
+    out << "\n};\n\n\n";
+
+    // --- constructor, getters, hand over ---
+    out << cls << "::" << cls << "(std::vector<T> code, bool stopAtOutput,\n"
+        << "        bool stopAtInput, bool printInOut, size_t pos) :\n"
+        << "        mem_(code), stopAtOutput_(stopAtOutput),\n"
+        << "        stopAtInput_(stopAtInput), printInOut_(printInOut),\n"
+        << "        pos_(pos), inputCount_(0), relBase_(0), stopped_(false)\n"
+        << "{\n"
+        << "    // a program differing in any code cell is interpreted\n"
+        << "    bool same = code.size() >= IMAGE_SIZE;\n"
+        << "    for (size_t i = 0; same && i < IMAGE_SIZE; i++) {\n"
+        << "        same = !CODE[i] || code[i] == IMAGE[i];\n"
+        << "    }\n\n"
+        << "    if (!same) {\n"
+        << "        interp_.emplace(code, stopAtOutput, stopAtInput, "
+        << "printInOut, pos);\n"
+        << "    }\n"
+        << "}\n\n\n";
+
+    out << "size_t " << cls << "::getPosition() const {\n"
+        << "    return interp_ ? interp_->getPosition() : pos_;\n"
+        << "}\n\n\n";
+    out << "std::vector<T> " << cls << "::getCode() const {\n"
+        << "    return interp_ ? interp_->getCode() : mem_.toVector();\n"
+        << "}\n\n\n";
+    out << "std::vector<T> " << cls << "::getOutput() const {\n"
+        << "    // after a hand over, output of this call is split between\n"
+        << "    // outPrefix_ and the interpreter\n"
+        << "    if (!interp_) { return lastOut_; }\n\n"
+        << "    std::vector<T> out = interp_->getOutput();\n"
+        << "    if (stopAtOutput_ && !stopAtInput_) {\n"
+        << "        return out.empty() ? outPrefix_ : out;\n"
+        << "    }\n\n"
+        << "    out.insert(out.begin(), outPrefix_.begin(), "
+        << "outPrefix_.end());\n"
+        << "    return out;\n"
+        << "}\n\n\n";
+
+    out << "T " << cls << "::readInput(const T * in, size_t nIn) {\n"
+        << "    T val;\n"
+        << "    inputCount_++;\n"
+        << "    if (inputCount_ <= nIn) {\n"
+        << "        val = in[inputCount_-1];\n"
+        << "    } else {\n"
+        << "        std::cout << \"Too few input arguments provided, type \"\n"
+        << "                  << \"Input here: \";\n"
+        << "        std::cin >> val;\n"
+        << "    }\n"
+        << "    return val;\n"
+        << "}\n\n\n";
+
+    out << "bool " << cls << "::fallback(const T * in, size_t nIn) {\n"
+        << "    // hands the machine over to the interpreter at pos_, with the\n"
+        << "    // inputs of this call that were not consumed yet\n"
+        << "    interp_.emplace(mem_.toVector(), stopAtOutput_, "
+        << "stopAtInput_, printInOut_,\n"
+        << "                    pos_, relBase_);\n"
+        << "    outPrefix_ = lastOut_;\n\n"
+        << "    size_t used = inputCount_ < nIn ? inputCount_ : nIn;\n"
+        << "    return interp_->runIntCode(std::vector<T>(in + used, "
+        << "in + nIn));\n"
+        << "}\n\n\n";
+
+    out << "bool " << cls << "::resume(const T * in, size_t nIn) {\n"
+        << "    if (stopAtInput_) { outPrefix_.clear(); }\n"
+        << "    return interp_->runIntCode(std::vector<T>(in, in + nIn));\n"
+        << "}\n\n\n";
+
+    // --- translated program ---
+    out << "bool " << cls << "::run(const T * in, size_t nIn) {\n"
+        << "    if (interp_) { return resume(in, nIn); }\n\n"
+        << "    if (stopAtInput_) {\n"
+        << "        lastOut_.resize(0);\n"
+        << "        inputCount_ = 0;\n"
+        << "    } else if (stopAtOutput_) {\n"
+        << "        inputCount_ = 0;\n"
+        << "    }\n\n"
+        << "    T a, b;\n"
+        << "    size_t addr;\n"
+        << "    (void)addr;\n\n"
+        << "dispatch:\n"
+        << "    switch (pos_) {\n";
+    for (size_t p: starts) {
+        out << "        case " << p << ": goto L" << p << ";\n";
+    }
+    out << "        default: return fallback(in, nIn);\n"
+        << "    }\n\n";
+
+    for (const instr & ins: instructions) {
+        size_t p = ins.pos;
+        const long long * v = ins.param;
+        size_t next = p + ins.length;
+
+        auto param = [&](int i) {
+            return readParam(live, p+1+i, ins.mode[i], v[i]);
+        };
+
+        std::string gotoNext = starts.count(next) ?
+            "    goto L" + std::to_string(next) + ";\n" :
+            "    pos_ = " + std::to_string(next) + "; goto dispatch;\n";
+
+        out << "L" << p << ": // " << code[p];
+        for (size_t i = 0; i+1 < ins.length; i++) { out << "," << v[i]; }
+        out << "\n";
+
+        switch (ins.opcode) {
+            case 1: case 2: case 7: case 8: {
+                const char * expr = ins.opcode == 1 ? "a + b" :
+                                    ins.opcode == 2 ? "a * b" :
+                                    ins.opcode == 7 ? "T(a < b)" : "T(a == b)";
+                out << "    a = " << param(0) << ";\n";
+                out << "    b = " << param(1) << ";\n";
+                if (!writeParam(out, live, isCode, p, 2, ins.mode[2], v[2],
+                                next, expr))
+                {
+                    out << gotoNext;
+                }
+                break;
+            }
+            case 3:
+                out << "    if (" << (p > 0) << " && stopAtInput_ && "
+                    << "!stopped_) {\n"
+                    << "        stopped_ = true; pos_ = " << p << ";"
+                    << " return false;\n    }\n";
+                out << "    a = readInput(in, nIn);\n";
+                out << "    stopped_ = false;\n";
+                out << "    if (printInOut_) { std::cout << \"in: \" << a "
+                    << "<< \"\\n\"; }\n";
+                if (!writeParam(out, live, isCode, p, 0, ins.mode[0], v[0],
+                                next, "a"))
+                {
+                    out << gotoNext;
+                }
+                break;
+            case 4:
+                out << "    if (stopAtOutput_) { lastOut_.resize(0); }\n";
+                out << "    lastOut_.push_back(" << param(0) << ");\n";
+                out << "    if (printInOut_) { std::cout << \"out: \" << "
+                    << "lastOut_.back() << \"\\n\"; }\n";
+                out << "    if (stopAtOutput_) { pos_ = " << next
+                    << "; return false; }\n";
+                out << gotoNext;
+                break;
+            case 5: case 6:
+                out << "    if ((" << param(0)
+                    << (ins.opcode == 5 ? " != 0" : " == 0") << ")) {\n";
+                if (ins.mode[1] == 1 && !live.count(p+2) &&
+                    starts.count(v[1]))
+                {
+                    out << "        goto L" << v[1] << ";\n";
+                } else {
+                    out << "        pos_ = size_t(" << param(1)
+                        << "); goto dispatch;\n";
+                }
+                out << "    }\n" << gotoNext;
+                break;
+            case 9:
+                out << "    relBase_ += " << param(0) << ";\n" << gotoNext;
+                break;
+            case 99:
+                out << "    pos_ = " << p << ";\n";
+                out << "    if (printInOut_) { std::cout << \"99 - HALTED\\n\"; }"
+                    << "\n    return true;\n";
+                break;
+        }
+    }
+
+    out << "}\n";
+}
+
+
+// ############
+// --- MAIN ---
+// ############
+
+int main(int argc, char ** argv) {
+    std::string type = "long";
+    std::vector<std::pair<size_t, long long>> patches;
+    std::vector<std::string> args;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        if (arg == "-t" && i+1 < argc) {
+            type = argv[++i];
+        } else if (arg == "-p" && i+1 < argc) {
+            std::string patch(argv[++i]);
+            size_t eq = patch.find('=');
+            if (eq == std::string::npos) {
+                std::cerr << "ERROR: patch must be of form ADDR=VALUE\n";
+                return 1;
+            }
+            patches.push_back({std::stoull(patch.substr(0, eq)),
+                               std::stoll(patch.substr(eq+1))});
+        } else {
+            args.push_back(arg);
+        }
+    }
+
+    if (args.size() != 3) {
+        std::cerr << "usage: intCodeToCpp.exe [-t TYPE] [-p ADDR=VALUE ...] "
+                  << "PROGRAM CLASS OUT\n";
+        return 1;
+    }
+
+    std::vector<long long> code;
+    try {
+        code = loadProgram<long long>(args[0]);
+    } catch (const std::runtime_error & e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+
+    for (const auto & p: patches) {
+        if (p.first >= code.size()) { code.resize(p.first+1, 0); }
+        code[p.first] = p.second;
+    }
+
+    disassembler<long long> dis(code);
+    const std::vector<instr> & instructions = dis.getInstructions();
+    std::set<size_t> live = findLiveCells(instructions);
+
+    std::set<size_t> starts;
+    std::vector<char> isCode(code.size(), 0);
+    for (const instr & ins: instructions) {
+        starts.insert(ins.pos);
+        for (size_t i = 0; i < ins.length; i++) {
+            isCode[ins.pos+i] = !live.count(ins.pos+i) || i == 0;
+        }
+    }
+
+    std::string header = args[2] + ".hpp";
+    std::string headerName = header.substr(header.find_last_of('/') + 1);
+
+    std::ofstream hFile(header);
+    writeHeader(hFile, args[1], type, args[0]);
+
+    std::ofstream cFile(args[2] + ".cpp");
+    writeSource(cFile, args[1], headerName, args[0], code, instructions,
+                starts, live, isCode);
+
+    size_t cells = 0;
+    for (char c: isCode) { cells += c; }
+
+    std::cout << args[0] << ": " << starts.size() << " instructions ("
+              << cells << " code cells of " << code.size()
+              << " integers) translated to " << args[2] << ".{hpp,cpp}\n";
+}
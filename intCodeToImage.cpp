@@ -0,0 +1,50 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+#include "./src/intCodeImage.hpp"
+#include "./src/programLoader.hpp"
+
+
+/*
+Converts an Intcode program (comma separated text) into a binary image, see
+src/intCodeImage.hpp.
+
+# intCodeToImage.exe [-w WIDTH] PROGRAM IMAGE
+- Arguments:
+    PROGRAM - comma separated int code, e.g. input_files/in09.txt
+    IMAGE - image file written, e.g. images/in09.icim
+    -w WIDTH - word width in bytes, 8 (default) or 4. An image can be loaded
+               without copying by an intCode<T> with sizeof(T) == WIDTH
+*/
+
+
+int main(int argc, char ** argv) {
+    int width = 8;
+    std::vector<std::string> args;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        if (arg == "-w" && i+1 < argc) { width = std::stoi(argv[++i]); }
+        else { args.push_back(arg); }
+    }
+
+    if (args.size() != 2 || (width != 4 && width != 8)) {
+        std::cerr << "usage: intCodeToImage.exe [-w 4|8] PROGRAM IMAGE\n";
+        return 1;
+    }
+
+    std::vector<long long> code;
+    try {
+        code = loadProgram<long long>(args[0]);
+        intCodeImage<long long>::save(args[1], code, width);
+    } catch (const std::runtime_error & e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+
+    std::cout << args[1] << ": " << code.size() << " words of " << width
+              << " bytes\n";
+}
@@ -3,68 +3,45 @@
 #include <string>
 #include <vector>
 
-
-void runIntCode(std::vector<int> & code) {
-    for (size_t i = 0; i < code.size(); i+=4) {
-        int opcode = code[i];
-        int param1 = code[i+1];
-        int param2 = code[i+2];
-        int param3 = code[i+3];
-
-        if (opcode == 1) // ALTERNATIVE: Expression templates
-            code[param3] = code[param1] + code[param2];
-        else if (opcode == 2)
-            code[param3] = code[param1] * code[param2];
-        else if (opcode == 99)
-            break;
-        else {
-            std::cout << "ERROR: something went wrong - opcode = " << opcode;
-            std::cout << " (opcode must be 1, 2 or 99)\n";
-        }
-    }
-}
+#include "./src/batchRunner.hpp"
+#include "./src/inverseSolver.hpp"
+#include "./src/programLoader.hpp"
 
 
 void findInput(const std::vector<int> & initCode,
                const int & desiredOut, std::vector<int> & input)
 {
-    for (int noun = 0; noun < 99; noun++) {
-        for (int verb = 0; verb < 99; verb++) {
-            std::vector<int> modCode(initCode);
-
-            modCode[1] = noun;
-            modCode[2] = verb;
-            runIntCode(modCode);
-            if (modCode[0] == desiredOut) {
-                input.push_back(noun);
-                input.push_back(verb);
-                std::cout << "\n - - - PART 2 - - - \n";
-                std::cout << "OUTPUT: " << modCode[0];
-                std::cout << " with input (solution) " << 100*noun+verb << "\n";
-                break;
-            }
-            if (noun == 12 && verb == 2) {
-                std::cout << "\n - - - PART 1 - - - \n";
-                std::cout << "Value at position 0: " << modCode[0] << "\n";
-            }
-        }
+    // solves for the noun (address 1) and verb (address 2) giving desiredOut
+    // at position 0 on the closed form of the program, see inverseSolver.hpp,
+    // instead of running it for every pair. The solution is checked by
+    // running the program (batchRunner.hpp) like part 1
+
+    batchRunner<int> runner(initCode, {0});
+
+    batchRunner<int>::job part1{{{1, 12}, {2, 2}}, {}};
+    std::cout << "\n - - - PART 1 - - - \n";
+    std::cout << "Value at position 0: " << runner.run({part1})[0].peek[0]
+              << "\n";
+
+    inverseSolver<int> solver(initCode, {1, 2}, {{0, 99}, {0, 99}});
+    std::vector<std::vector<int>> solutions = solver.solveCell(0, desiredOut);
+
+    if (!solutions.empty()) {
+        int noun = solutions[0][0];
+        int verb = solutions[0][1];
+        batchRunner<int>::job part2{{{1, noun}, {2, verb}}, {}};
+        input.push_back(noun);
+        input.push_back(verb);
+        std::cout << "\n - - - PART 2 - - - \n";
+        std::cout << "OUTPUT: " << runner.run({part2})[0].peek[0];
+        std::cout << " with input (solution) " << 100*noun+verb << "\n";
     }
-
 }
 
 
 // ----- MAIN -----
 int main() {
-    std::ifstream inFile("./input_files/in02.txt");
-
-    std::vector<int> initCode;
-    std::string val;
-
-    if (inFile.is_open()) {
-        while (getline(inFile, val, ',')) {
-            initCode.push_back(std::stoi(val));
-        }
-    }
+    std::vector<int> initCode = loadProgram<int>("./input_files/in02.txt");
 
     int desiredOut = 19690720;
     std::vector<int> input;
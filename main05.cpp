@@ -5,6 +5,7 @@
 #include <vector>
 
 #include "./src/intCode.hpp"
+#include "./src/programLoader.hpp"
 
 
 // ############
@@ -12,16 +13,7 @@
 // ############
 int main() {
 
-    std::ifstream inFile("./input_files/in05.txt");
-
-    std::vector<int> initCode;
-    std::string val;
-
-    if (inFile.is_open()) {
-        while (getline(inFile, val, ',')) {
-            initCode.push_back(std::stoi(val));
-        }
-    }
+    std::vector<int> initCode = loadProgram<int>("./input_files/in05.txt");
 
     bool stopAtOutput = false;
     bool stopAtInput = false;
@@ -2,20 +2,27 @@
 #include <algorithm>
 
 #include "./src/intCode.hpp"
-
-
-void readData(const std::string & data_path, std::vector<int> & data) {
-    std::ifstream inFile(data_path);
-
-    std::string val;
-    if (inFile.is_open()) {
-        while (getline(inFile, val, ',')) {
-            data.push_back(std::stoi(val));
-        }
-        inFile.close();
+#include "./src/scheduler.hpp"
+#include "./src/specializer.hpp"
+#include "./src/programLoader.hpp"
+
+
+std::vector<intCode<int>> specializeAmps(const std::vector<int> & initCode,
+                                         int firstPhase, int phases)
+{
+    // one machine per phase setting, running initCode specialized to its
+    // phase (the first input), see specializer.hpp. Only the amplification
+    // of the signal is left, the machines read the signal(s) right away
+
+    std::vector<intCode<int>> amps;
+    for (int phase = firstPhase; phase < firstPhase + phases; phase++) {
+        specializer<int> spec(initCode, {}, {phase}, std::vector<size_t>{});
+        amps.emplace_back(spec.getResidual(), false, false, false,
+                          spec.getEntry());
     }
-}
 
+    return amps;
+}
 
 
 void ampSeries(std::vector<int> & initCode) {
@@ -27,23 +34,22 @@ void ampSeries(std::vector<int> & initCode) {
     std::vector<int> phase{0,1,2,3,4};
     int maxOut = 0;
     std::vector<int> maxPhase;
+    std::vector<intCode<int>> amps = specializeAmps(initCode, 0, 5);
 
     do {
-        std::vector<int> input(2);
-        std::vector<int> out{0};
+        // links[i] is the input of amp i and the output of amp i-1
+        std::vector<channel<int>> links(phase.size()+1, channel<int>(2));
+        links[0].push(0);
 
         for (size_t i = 0; i < phase.size(); i++) {
-            intCode<int> IC(initCode);
-
-            input[0] = phase[i];
-            input[1] = out[0];
-
-            IC.runIntCode(input);
-            out = IC.getOutput();
+            intCode<int> IC = amps[phase[i]].fork();
+            IC.runIntCode(links[i], links[i+1]);
         }
 
-        if (out[0] > maxOut) {
-            maxOut = out[0];
+        int out = links.back().front();
+
+        if (out > maxOut) {
+            maxOut = out;
             maxPhase = phase;
         }
     } while (std::next_permutation(phase.begin(), phase.end()));
@@ -62,45 +68,24 @@ void ampFeedbackLoop(std::vector<int> & initCode) {
     std::vector<int> phase{5,6,7,8,9};
     int maxOut = 0;
     std::vector<int> maxPhase;
-
-    bool stopAtOutput = true;
+    std::vector<intCode<int>> specialized = specializeAmps(initCode, 5, 5);
 
     do {
-        std::vector<intCode<int>> amps;
-        bool halted = false;
-
-        std::vector<int> input(2);
-        std::vector<int> out{0};
-
-        // initialize amplifiers until first output
-        // after first run of for loop, out is output of amp 5, input for amp 1
+        // amp i writes to amp i+1, the last amp to amp 0
+        scheduler<int> amps(2);
         for (size_t i = 0; i < phase.size(); i++) {
-            intCode<int> IC(initCode, stopAtOutput, false, false);
-
-            input[0] = phase[i];
-            input[1] = out[0];
-
-            halted = IC.runIntCode(input);
-            out = IC.getOutput();
-
-            amps.push_back(IC); // push_back() copies, so no scope issues
+            amps.addMachine(specialized[phase[i] - 5].fork());
         }
-
-        input.resize(1);
-
-        int loop = 0;
-        while (!halted) {
-            for (size_t i = 0; i < amps.size(); i++) {
-                input[0] = out[0];
-                halted = amps[i].runIntCode(input);
-                std::vector<int> tempOut = amps[i].getOutput(); // NOTE SEG FAULT
-                out.swap(tempOut);
-            }
-            loop++;
+        for (size_t i = 0; i < phase.size(); i++) {
+            amps.connect(i, (i+1) % phase.size());
         }
+        amps.push(0, 0);
+
+        amps.run();
+        int out = amps.getInput(0).front();
 
-        if (out[0] > maxOut) {
-            maxOut = out[0];
+        if (out > maxOut) {
+            maxOut = out;
             maxPhase = phase;
         }
     } while (std::next_permutation(phase.begin(), phase.end()));
@@ -121,7 +106,7 @@ int main() {
     std::string data_path = "./input_files/in07.txt";
     std::vector<int> initCode;
 
-    readData(data_path, initCode);
+    initCode = loadProgram<int>(data_path);
 
     ampSeries(initCode);
 
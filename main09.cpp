@@ -1,38 +1,39 @@
 #include <fstream>
 #include <algorithm>
+#include <array>
 
 #include "./src/intCode.hpp"
+#include "./src/programLoader.hpp"
+#include "./src/constIntCode.hpp"
 
+// make main09_aot.exe runs the program translated by intCodeToCpp
+#ifdef INTCODE_AOT
+#include "./aot/in09.hpp"
+template<typename T> using machine = aot_in09;
+#else
+template<typename T> using machine = intCode<T>;
+#endif
 
-template<typename T>
-void readData(const std::string & data_path, std::vector<T> & data) {
-    std::ifstream inFile(data_path);
-
-    std::string val;
-    if (inFile.is_open()) {
-        while (getline(inFile, val, ',')) {
-            if (std::is_same<T, int>::value) {
-                data.push_back(std::stoi(val));
-            } else if (std::is_same<T, long>::value) {
-                data.push_back(std::stol(val));
-            }
-        }
-        inFile.close();
-    }
-}
 
+// example programs of day 9, run during compilation (see constIntCode.hpp):
+// a quine, a 16-digit product and a large output value
+constexpr std::array<long, 16> test0{109,1,204,-1,1001,100,1,100,1008,100,16,101,1006,101,0,99};
+constexpr std::array<long, 8> test1{1102,34915192,34915192,7,4,7,99,0};
+constexpr std::array<long, 3> test2{104,1125899906842624,99};
 
+static_assert(evalIntCode<128>(test0).outputIs(test0),
+              "day 9: test0 must output itself");
+static_assert(evalIntCode<8>(test1).getOutput(0) == 1219070632396864,
+              "day 9: test1 must output a 16-digit number");
+static_assert(evalIntCode<3>(test2).getOutput(0) == 1125899906842624,
+              "day 9: test2 must output the number in the middle");
 
 
 int main() {
     std::string data_path = "./input_files/in09.txt";
     std::vector<long> initCode;
 
-    std::vector<long> test0{109,1,204,-1,1001,100,1,100,1008,100,16,101,1006,101,0,99};
-    std::vector<long> test1{1102,34915192,34915192,7,4,7,99,0};
-    std::vector<long> test2{104,1125899906842624,99};
-
-    readData(data_path, initCode);
+    initCode = loadProgram<long>(data_path);
 
     bool stopAtOutput = false;
     bool stopAtInput = false;
@@ -42,7 +43,7 @@ int main() {
         std::cout << "\n - - - PART 1 - - - \n";
 
         std::vector<long> input{1};
-        intCode<long> IC(initCode, stopAtOutput, stopAtInput, printInOut);
+        machine<long> IC(initCode, stopAtOutput, stopAtInput, printInOut);
         IC.runIntCode(input);
     }
 
@@ -50,7 +51,7 @@ int main() {
         std::cout << "\n - - - PART 2 - - - \n";
 
         std::vector<long> input{2};
-        intCode<long> IC(initCode, stopAtOutput, stopAtInput, printInOut);
+        machine<long> IC(initCode, stopAtOutput, stopAtInput, printInOut);
         IC.runIntCode(input);
     }
 }
@@ -3,34 +3,8 @@
 #include <vector>
 #include <map>
 
-#include "./src/intCode.hpp"
-
-
-template<typename T>
-void loadData(const std::string & data_path, std::vector<T> & data) {
-	static_assert(std::is_same<int, T>::value ||
-				  std::is_same<long, T>::value ||
-				  std::is_same<long long, T>::value,
-				  "ERROR: function loadData() must be called with template\
-parameter of type <signed int>, i.e., int, long, etc.");
-
-
-	std::ifstream inFile(data_path);
-
-    std::string val;
-    if (inFile.is_open()) {
-        while (getline(inFile, val, ',')) {
-            if (std::is_same<T, int>::value) {
-                data.push_back(std::stoi(val));
-            } else if (std::is_same<T, long>::value) {
-                data.push_back(std::stol(val));
-            } else if (std::is_same<T, long long>::value) {
-                data.push_back(std::stoll(val));
-            }
-        }
-        inFile.close();
-    }
-}
+#include "./src/generator.hpp"
+#include "./src/programLoader.hpp"
 
 
 template<typename T>
@@ -46,35 +20,29 @@ void runRobot(const std::vector<T> initCode,
 	//   1 turn 90 degrees right)
 	// --------------------------
 
-	bool stopAtOutput = false;
-    bool stopAtInput = true;
-    bool printInOut = false;
-
-	intCode<T> IC(initCode, stopAtOutput, stopAtInput, printInOut);
+	// the program yields color and turn, then awaits the color of the
+	// panel below the robot, see generator.hpp
+	generator<T> robot(initCode);
 
     grid.insert({std::vector<int>{0,0}, false});
 	int dir = 0; // in degrees, 0 pointing up, 90 pointing right
 	std::vector<int> gridPos{0,0};
 
-	std::vector<T> input{initInput};
-    std::vector<T> output(2);
-    bool halted = false;
-
-	while (!halted) {
-        halted = IC.runIntCode(input);
-        output = IC.getOutput();
+	robot.send(initInput);
+	T color, turn;
 
+	while (robot.next(color) && robot.next(turn)) {
 		// change color of grid tile depending on output of intCode
-		if (output[0] == 0 && grid[gridPos] == 1) {
+		if (color == 0 && grid[gridPos] == 1) {
 			grid[gridPos] = false;
-		} else if (output[0] == 1 && grid[gridPos] == 0) {
+		} else if (color == 1 && grid[gridPos] == 0) {
 			grid[gridPos] = true;
 		}
 
 		// rotate robot
-        if (output[1] == 1) {
+        if (turn == 1) {
             dir = (dir == 270 ? 0 : (dir+90));
-        } else if (output[1] == 0) {
+        } else if (turn == 0) {
             dir = (dir == 0 ? 270 : (dir-90));
         }
 
@@ -92,13 +60,13 @@ void runRobot(const std::vector<T> initCode,
 
 		// get color of tile currently on
 		if (current != grid.end()) {
-            input[0] = current->second;
+            robot.send(current->second);
         } else {
 			grid.insert({gridPos, false});
-			input[0] = 0;
+			robot.send(0);
 		}
 
-    } // WHILE: !halted
+    } // WHILE: robot paints
 }
 
 
@@ -206,7 +174,7 @@ int main() {
     std::string data_path = "./input_files/in11.txt";
     std::vector<long> initCode;
 
-	loadData(data_path, initCode);
+	initCode = loadProgram<long>(data_path);
 
 	std::cout << "\n - - - PART I - - -\n";
 
@@ -4,37 +4,17 @@
 #include <vector>
 
 #include "./src/intCode.hpp"
+#include "./src/programLoader.hpp"
 
+// make main13_aot.exe runs the program translated by intCodeToCpp
+#ifdef INTCODE_AOT
+#include "./aot/in13.hpp"
+template<typename T> using machine = aot_in13;
+#else
+template<typename T> using machine = intCode<T>;
+#endif
 
 
-template<typename T>
-void loadData(const std::string & data_path, std::vector<T> & data) {
-	static_assert(std::is_same<int, T>::value ||
-				  std::is_same<long, T>::value ||
-				  std::is_same<long long, T>::value,
-				  "ERROR: function loadData() must be called with template \
-parameter of type <signed int>, i.e., int, long, etc.");
-
-
-	std::ifstream inFile(data_path);
-
-    std::string val;
-    if (inFile.is_open()) {
-        while (getline(inFile, val, ',')) {
-            if (std::is_same<T, int>::value) {
-                data.push_back(std::stoi(val));
-            } else if (std::is_same<T, long>::value) {
-                data.push_back(std::stol(val));
-            } else if (std::is_same<T, long long>::value) {
-                data.push_back(std::stoll(val));
-            }
-        }
-        inFile.close();
-    } else {
-        std::cout << "Error: could not open file " << data_path << "\n";
-    }
-}
-
 
 template <typename T>
 unsigned get_tile_coords(const std::vector<T> & output,
@@ -70,7 +50,7 @@ T run_arcade(const std::vector<T> & initCode)
     std::vector<T> output;
     bool halted = false;
 
-	intCode<T> IC(modCode, stopAtOutput, stopAtInput, printInOut);
+	machine<T> IC(modCode, stopAtOutput, stopAtInput, printInOut);
 
     halted = IC.runIntCode();
     output = IC.getOutput();
@@ -126,7 +106,7 @@ int main() {
     std::string data_path = "./input_files/in13.txt";
     std::vector<int> initCode;
 
-    loadData(data_path, initCode);
+    initCode = loadProgram<int>(data_path);
 
     int final_score = run_arcade(initCode);
 
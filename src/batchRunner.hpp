@@ -0,0 +1,349 @@
+#ifndef BATCHRUNNER_HPP
+#define BATCHRUNNER_HPP
+
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstddef>
+
+#include "intCode.hpp"
+#include "channel.hpp"
+
+
+/*
+Runs many independent executions of the same Intcode program in parallel,
+e.g. all noun/verb pairs of day 2. Every job starts from a fork of one
+machine built from the program image (copy-on-write, see intCode::fork()),
+applies its patches, consumes its inputs and runs until it halts or waits for
+an input it was not given.
+
+Jobs are split into one contiguous range per worker thread. A worker takes
+jobs from the front of its own range; once it is empty, it steals the upper
+half of the largest remaining range of another worker, so uneven job lengths
+do not leave threads idle.
+
+The calling thread is worker 0. The other workers are started by the first
+run() that needs them and wait on a condition variable between batches, so
+a run() with a few short jobs (e.g. one per noun/verb guess) does not pay
+for starting and joining threads. They are joined by the destructor.
+
+--- TEMPLATE PARAMETERS ---
+
+# batchRunner<T, D = threadedDispatch>
+    T, D - see intCode<T, D>
+
+
+--- CONSTRUCTOR ---
+
+# batchRunner(const std::vector<T> & image, std::vector<size_t> watch = {},
+              unsigned threads = 0)
+- Arguments:
+    image - int code all jobs start from
+    watch - memory addresses whose values are reported after each job
+            (result::peek), e.g. {0} for day 2
+    threads - number of worker threads, 0 (default): one per hardware thread
+
+# batchRunner(const intCode<T, D> & proto, std::vector<size_t> watch = {},
+              unsigned threads = 0)
+- jobs start from forks of proto instead, e.g. a machine running the
+  residual program of a specializer from its entry (see specializer.hpp)
+
+
+--- FUNCTIONS ---
+
+# std::vector<result> run(const std::vector<job> & jobs,
+                          std::function<bool(const result &)> stop = nullptr)
+- Arguments:
+    jobs - job::patch (address, value) pairs written before the run,
+           job::input values passed to the input instructions
+    stop - called on the result of every finished job (from the worker
+           threads, so it must be thread-safe). Returning true cancels the
+           batch: jobs that have not been started are skipped
+- Returns:
+    one result per job, in the order of jobs. result::done is false for
+    skipped jobs, otherwise result::halted, result::output (all outputs),
+    result::peek (values at the watched addresses) and result::instructions
+    (instructions executed) describe the run
+- not to be called from several threads at once
+*/
+
+template<typename T, typename D = threadedDispatch>
+class batchRunner {
+    public:
+        struct job {
+            std::vector<std::pair<size_t, T>> patch;
+            std::vector<T> input;
+        };
+
+        struct result {
+            bool done;
+            bool halted;
+            std::vector<T> output;
+            std::vector<T> peek;
+            size_t instructions;
+        };
+
+        // Ctor
+        batchRunner() = delete;
+        batchRunner(const std::vector<T> & image,
+                    std::vector<size_t> watch = {}, unsigned threads = 0) :
+                proto_(image), watch_(watch), threads_(threads),
+                batch_(nullptr), generation_(0), busy_(0), quit_(false)
+        {
+            if (threads_ == 0) {
+                threads_ = std::max(1u, std::thread::hardware_concurrency());
+            }
+        }
+        batchRunner(const intCode<T, D> & proto,
+                    std::vector<size_t> watch = {}, unsigned threads = 0) :
+                proto_(proto.fork()), watch_(watch), threads_(threads),
+                batch_(nullptr), generation_(0), busy_(0), quit_(false)
+        {
+            if (threads_ == 0) {
+                threads_ = std::max(1u, std::thread::hardware_concurrency());
+            }
+        }
+
+        batchRunner(const batchRunner &) = delete;
+        batchRunner & operator=(const batchRunner &) = delete;
+        ~batchRunner();
+
+        // Public Member
+        std::vector<result> run(const std::vector<job> &,
+                                std::function<bool(const result &)> = nullptr);
+
+    private:
+        struct range {
+            std::mutex lock;
+            size_t begin;
+            size_t end;
+        };
+
+        struct batch {
+            std::vector<range> ranges; // one per worker of this batch
+            const std::vector<job> * jobs;
+            std::vector<result> * res;
+            const std::function<bool(const result &)> * stop;
+            std::atomic<bool> cancelled;
+        };
+
+        intCode<T, D> proto_;
+        std::vector<size_t> watch_;
+        unsigned threads_;
+
+        std::vector<std::thread> pool_; // workers 1, 2, ...
+        std::mutex poolMu_;
+        std::condition_variable startCv_;
+        std::condition_variable doneCv_;
+        batch * batch_; // current batch
+        size_t generation_; // batches started so far
+        size_t busy_; // pool workers not done with the current batch
+        bool quit_;
+
+        // Private Member
+        void serve(size_t);
+        void work(size_t, batch &) const;
+        static bool take(range &, size_t &);
+        static bool steal(size_t, std::vector<range> &);
+        void execute(const job &, result &) const;
+};
+
+
+// ------------------------
+// --- MEMBER FUNCTIONS ---
+// ------------------------
+
+// --- PUBLIC ---
+
+template<typename T, typename D>
+std::vector<typename batchRunner<T, D>::result> batchRunner<T, D>::run(
+        const std::vector<job> & jobs,
+        std::function<bool(const result &)> stop)
+{
+    std::vector<result> res(jobs.size(), result{false, false, {}, {}, 0});
+
+    size_t workers = std::min<size_t>(threads_, jobs.size());
+    if (workers == 0) { return res; }
+
+    batch b;
+    b.ranges = std::vector<range>(workers);
+    for (size_t w = 0; w < workers; w++) {
+        b.ranges[w].begin = jobs.size() * w / workers;
+        b.ranges[w].end = jobs.size() * (w+1) / workers;
+    }
+    b.jobs = &jobs;
+    b.res = &res;
+    b.stop = &stop;
+    b.cancelled.store(false);
+
+    if (workers == 1) {
+        work(0, b);
+        return res;
+    }
+
+    // the calling thread is worker 0, the pool takes the other ranges
+    {
+        std::lock_guard<std::mutex> lock(poolMu_);
+        while (pool_.size() + 1 < threads_) {
+            pool_.emplace_back(&batchRunner::serve, this, pool_.size() + 1);
+        }
+        batch_ = &b;
+        generation_++;
+        busy_ = pool_.size();
+    }
+    startCv_.notify_all();
+
+    work(0, b);
+
+    std::unique_lock<std::mutex> lock(poolMu_);
+    doneCv_.wait(lock, [this]{ return busy_ == 0; });
+    batch_ = nullptr;
+
+    return res;
+}
+
+
+template<typename T, typename D>
+batchRunner<T, D>::~batchRunner() {
+    {
+        std::lock_guard<std::mutex> lock(poolMu_);
+        quit_ = true;
+    }
+    startCv_.notify_all();
+
+    for (std::thread & t: pool_) { t.join(); }
+}
+
+
+// --- PRIVATE ---
+
+template<typename T, typename D>
+void batchRunner<T, D>::serve(size_t w) {
+    // thread of pool worker w: waits for the next batch, works on it if the
+    // batch has a range for w, reports back and waits again until quit_
+    // -----------------
+
+    size_t seen = 0;
+    std::unique_lock<std::mutex> lock(poolMu_);
+
+    while (true) {
+        startCv_.wait(lock, [&]{ return quit_ || generation_ != seen; });
+        if (quit_) { return; }
+        seen = generation_;
+
+        batch * b = batch_;
+        lock.unlock();
+        if (w < b->ranges.size()) { work(w, *b); }
+        lock.lock();
+
+        if (--busy_ == 0) { doneCv_.notify_one(); }
+    }
+}
+
+
+template<typename T, typename D>
+void batchRunner<T, D>::work(size_t w, batch & b) const {
+    // worker loop: own range first, then steal until no job is left
+
+    const std::vector<job> & jobs = *b.jobs;
+    std::vector<result> & res = *b.res;
+    const std::function<bool(const result &)> & stop = *b.stop;
+
+    size_t i;
+    while (!b.cancelled.load(std::memory_order_relaxed)) {
+        if (!take(b.ranges[w], i)) {
+            if (!steal(w, b.ranges)) { return; }
+            continue;
+        }
+
+        execute(jobs[i], res[i]);
+
+        if (stop && stop(res[i])) {
+            b.cancelled.store(true, std::memory_order_relaxed);
+        }
+    }
+}
+
+
+template<typename T, typename D>
+bool batchRunner<T, D>::take(range & r, size_t & i) {
+    std::lock_guard<std::mutex> guard(r.lock);
+    if (r.begin == r.end) { return false; }
+
+    i = r.begin++;
+    return true;
+}
+
+
+template<typename T, typename D>
+bool batchRunner<T, D>::steal(size_t w, std::vector<range> & ranges) {
+    // moves the upper half of the largest other range to worker w. Returns
+    // false if all ranges are empty
+
+    while (true) {
+        size_t victim = w;
+        size_t most = 0;
+        for (size_t v = 0; v < ranges.size(); v++) {
+            if (v == w) { continue; }
+            std::lock_guard<std::mutex> guard(ranges[v].lock);
+            if (ranges[v].end - ranges[v].begin > most) {
+                most = ranges[v].end - ranges[v].begin;
+                victim = v;
+            }
+        }
+        if (victim == w) { return false; }
+
+        size_t begin, end;
+        {
+            std::lock_guard<std::mutex> guard(ranges[victim].lock);
+            range & r = ranges[victim];
+            if (r.begin == r.end) { continue; } // emptied in the meantime
+            begin = r.begin + (r.end - r.begin) / 2;
+            end = r.end;
+            r.end = begin;
+        }
+
+        std::lock_guard<std::mutex> guard(ranges[w].lock);
+        ranges[w].begin = begin;
+        ranges[w].end = end;
+        return true;
+    }
+}
+
+
+template<typename T, typename D>
+void batchRunner<T, D>::execute(const job & j, result & res) const {
+    // runs one job on a fork of proto_, outputs are collected through a
+    // channel that is drained whenever the machine blocks on it
+
+    intCode<T, D> vm = proto_.fork();
+    for (const auto & p: j.patch) {
+        vm.patch(p.first, p.second);
+    }
+
+    channel<T> in(j.input.size());
+    channel<T> out;
+    for (const T & val: j.input) { in.push(val); }
+
+    while (true) {
+        res.halted = vm.runIntCode(in, out);
+        size_t n = out.drain([&](const T & val) { res.output.push_back(val); });
+        if (res.halted || n == 0) { break; } // halted or waits for input
+    }
+
+    for (size_t addr: watch_) {
+        res.peek.push_back(vm.getMemory(addr));
+    }
+
+    res.instructions = vm.getInstructionCount();
+    res.done = true;
+}
+
+
+#endif // BATCHRUNNER_HPP
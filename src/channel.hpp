@@ -0,0 +1,96 @@
+#ifndef CHANNEL_HPP
+#define CHANNEL_HPP
+
+
+#include <vector>
+#include <cstddef>
+
+
+/*
+Bounded first-in first-out queue of integers on a ring buffer, used to pass
+inputs to and outputs from an intCode without copying vectors (see
+intCode::runIntCode(channel<T> &, channel<T> &)). The same channel can be the
+output of one machine and the input of the next, so chained machines share
+their values instead of handing copies around.
+
+The buffer is allocated once by the constructor, pushing and popping never
+allocate.
+
+--- CONSTRUCTOR ---
+
+# channel(size_t capacity = 64)
+- Arguments:
+    capacity - maximum number of values held at the same time, rounded up to
+               the next power of two
+
+
+--- FUNCTIONS ---
+
+# bool push(const T & val)
+- Returns:
+    false if the channel is full (val is not stored), true otherwise
+
+# bool pop(T & val)
+- Returns:
+    false if the channel is empty, true otherwise (oldest value moved to val)
+
+# const T & front() const, const T & back() const
+- Returns:
+    oldest and newest value (channel must not be empty)
+
+# template<typename F> size_t drain(F f)
+- Arguments:
+    f - called as f(val) for each value, oldest first
+- Returns:
+    number of values removed, the channel is empty afterwards
+
+# bool empty() const, bool full() const, size_t size() const,
+  size_t capacity() const, void clear()
+*/
+
+template<typename T>
+class channel {
+    public:
+        // Ctor
+        explicit channel(size_t capacity = 64) : head_(0), tail_(0) {
+            size_t n = 1;
+            while (n < capacity) { n <<= 1; }
+            buf_.resize(n);
+            mask_ = n-1;
+        }
+
+        // Getters
+        bool empty() const { return head_ == tail_; }
+        bool full() const { return tail_ - head_ == buf_.size(); }
+        size_t size() const { return tail_ - head_; }
+        size_t capacity() const { return buf_.size(); }
+        const T & front() const { return buf_[head_ & mask_]; }
+        const T & back() const { return buf_[(tail_-1) & mask_]; }
+
+        // Public Member
+        bool push(const T & val) {
+            if (full()) { return false; }
+            buf_[tail_++ & mask_] = val;
+            return true;
+        }
+        bool pop(T & val) {
+            if (empty()) { return false; }
+            val = buf_[head_++ & mask_];
+            return true;
+        }
+        template<typename F> size_t drain(F f) {
+            size_t n = size();
+            for (; head_ != tail_; head_++) { f(buf_[head_ & mask_]); }
+            return n;
+        }
+        void clear() { head_ = tail_ = 0; }
+
+    private:
+        std::vector<T> buf_;
+        size_t mask_;
+        size_t head_; // number of values popped so far
+        size_t tail_; // number of values pushed so far
+};
+
+
+#endif // CHANNEL_HPP
@@ -0,0 +1,270 @@
+#ifndef CONSTINTCODE_HPP
+#define CONSTINTCODE_HPP
+
+
+#include <array>
+#include <stdexcept>
+#include <type_traits>
+#include <cstddef>
+
+
+/*
+Intcode evaluator that runs during compilation: every member function is
+constexpr and the memory is a std::array of fixed size, so a small program
+with fixed inputs can be evaluated in a constant expression. Conformance
+tests become static_asserts, and results of fixed programs can be baked into
+the binary at no run-time cost, e.g.
+
+    constexpr std::array<long, 3> prog{104, 1125899906842624, 99};
+    static_assert(evalIntCode<16>(prog).getOutput(0) == 1125899906842624,
+                  "...");
+
+A program stored as text (integers separated by commas) can be embedded as
+an initializer: std::array<long, 971> prog{
+#include "input_files/in09.txt"
+};
+
+The instruction set is that of intCode (day 9, relative mode included); the
+machine can also be used at run time. A fault (invalid opcode or mode, an
+address outside the memory) throws std::runtime_error, which turns into a
+compile error when it happens in a constant expression. Compilers bound the
+work done in a constant expression (GCC: -fconstexpr-loop-limit, 262144
+iterations of a loop by default, and -fconstexpr-ops-limit), run() in a
+constant expression is limited to programs that finish within that.
+
+--- CONSTRUCTOR ---
+
+# constIntCode<T, M, OUT = 64>(const std::array<T, N> & code)
+- Arguments:
+    T - integer type of the machine, as intCode
+    M - number of integers of memory (at least N, the program is copied to
+        addresses 0 ... N-1, everything above is 0)
+    OUT - number of outputs the machine holds
+
+# constIntCode<T, M, OUT> evalIntCode<M, OUT = 64>(const std::array<T, N> & code,
+                                                    const std::array<T, K> & in)
+- runs code with the inputs in (none if omitted) and returns the machine
+
+
+--- FUNCTIONS ---
+
+# int run(const std::array<T, K> & in, size_t maxSteps = 100000),
+  int run(size_t maxSteps = 100000)
+- executes instructions, consuming the inputs in (one after another, from
+  the first one on every call), until
+- Returns:
+    HALTED - the program halted (further calls return HALTED immediately)
+    WAITING - an input instruction found no input left, call again with
+              more (the input instruction is executed then)
+    OUTPUT_FULL - OUT outputs are held already, the output instruction was
+                  not executed
+    STEP_LIMIT - maxSteps instructions were executed in this call
+
+# T getMemory(size_t addr) const, T getOutput(size_t i) const,
+  size_t getOutputCount() const, size_t getPosition() const,
+  T getRelativeBase() const, bool isHalted() const
+
+# bool outputIs(const std::array<T, N> & expected) const
+- true IFF the outputs are exactly expected (std::array::operator== is not
+  constexpr in C++17)
+*/
+
+template<typename T, size_t M, size_t OUT = 64>
+class constIntCode {
+    public:
+        static_assert(std::is_same<int, T>::value ||
+                      std::is_same<long, T>::value ||
+                      std::is_same<long long, T>::value,
+                      "ERROR: class constIntCode must be called with template\
+                       parameter of type <signed int>, i.e., int, long, etc.");
+
+        // Ctor
+        constIntCode() = delete;
+        template<size_t N>
+        constexpr explicit constIntCode(const std::array<T, N> & code) :
+                memory_{}, out_{}, outCount_(0), pos_(0), relBase_(0),
+                halted_(false)
+        {
+            static_assert(N <= M, "ERROR: program larger than the memory");
+            for (size_t i = 0; i < N; i++) { memory_[i] = code[i]; }
+        }
+
+        // Getters
+        constexpr T getMemory(size_t addr) const { return memory_[addr]; }
+        constexpr T getOutput(size_t i) const { return out_[i]; }
+        constexpr size_t getOutputCount() const { return outCount_; }
+        constexpr size_t getPosition() const { return pos_; }
+        constexpr T getRelativeBase() const { return relBase_; }
+        constexpr bool isHalted() const { return halted_; }
+
+        // Public Member
+        template<size_t K>
+        constexpr int run(const std::array<T, K> &, size_t maxSteps = 100000);
+        constexpr int run(size_t maxSteps = 100000) {
+            return run(std::array<T, 0>{}, maxSteps);
+        }
+        template<size_t N>
+        constexpr bool outputIs(const std::array<T, N> & expected) const {
+            if (N != outCount_) { return false; }
+            for (size_t i = 0; i < N; i++) {
+                if (out_[i] != expected[i]) { return false; }
+            }
+            return true;
+        }
+
+        // Static Constants
+        static const int HALTED = 0; // return values of run()
+        static const int WAITING = 1;
+        static const int OUTPUT_FULL = 2;
+        static const int STEP_LIMIT = 3;
+
+    private:
+        std::array<T, M> memory_;
+        std::array<T, OUT> out_;
+        size_t outCount_;
+        size_t pos_;
+        T relBase_;
+        bool halted_;
+
+        // Private Member
+        constexpr T & cell(T);
+        constexpr T & param(int, int);
+
+        // Static Constants
+        static const int ADD = 1;
+        static const int MULTIPLY = 2;
+        static const int INPUT = 3;
+        static const int OUTPUT = 4;
+        static const int JUMPTRUE = 5;
+        static const int JUMPFALSE = 6;
+        static const int LESS = 7;
+        static const int EQUAL = 8;
+        static const int ADJUSTBASE = 9;
+        static const int HALT = 99;
+
+        static const int POSITION = 0;
+        static const int IMMEDIATE = 1;
+        static const int RELATIVE = 2;
+};
+
+
+template<size_t M, size_t OUT = 64, typename T, size_t N, size_t K>
+constexpr constIntCode<T, M, OUT> evalIntCode(const std::array<T, N> & code,
+                                              const std::array<T, K> & in)
+{
+    constIntCode<T, M, OUT> vm(code);
+    vm.run(in);
+
+    return vm;
+}
+
+
+template<size_t M, size_t OUT = 64, typename T, size_t N>
+constexpr constIntCode<T, M, OUT> evalIntCode(const std::array<T, N> & code)
+{
+    return evalIntCode<M, OUT>(code, std::array<T, 0>{});
+}
+
+
+// ------------------------
+// --- MEMBER FUNCTIONS ---
+// ------------------------
+
+// --- PUBLIC ---
+
+template<typename T, size_t M, size_t OUT>
+template<size_t K>
+constexpr int constIntCode<T, M, OUT>::run(const std::array<T, K> & in,
+                                           size_t maxSteps)
+{
+    size_t next = 0; // next input
+
+    for (size_t step = 0; step < maxSteps; step++) {
+        if (halted_) { return HALTED; }
+
+        T word = cell(T(pos_));
+        int opcode = int(word % 100);
+        int m0 = int(word / 100 % 10);
+        int m1 = int(word / 1000 % 10);
+        int m2 = int(word / 10000 % 10);
+
+        switch (opcode) {
+            case ADD:
+                param(2, m2) = param(0, m0) + param(1, m1);
+                pos_ += 4;
+                break;
+            case MULTIPLY:
+                param(2, m2) = param(0, m0) * param(1, m1);
+                pos_ += 4;
+                break;
+            case INPUT:
+                if (next == K) { return WAITING; }
+                param(0, m0) = in[next++];
+                pos_ += 2;
+                break;
+            case OUTPUT:
+                if (outCount_ == OUT) { return OUTPUT_FULL; }
+                out_[outCount_++] = param(0, m0);
+                pos_ += 2;
+                break;
+            case JUMPTRUE:
+                pos_ = param(0, m0) != 0 ? size_t(param(1, m1)) : pos_ + 3;
+                break;
+            case JUMPFALSE:
+                pos_ = param(0, m0) == 0 ? size_t(param(1, m1)) : pos_ + 3;
+                break;
+            case LESS:
+                param(2, m2) = param(0, m0) < param(1, m1);
+                pos_ += 4;
+                break;
+            case EQUAL:
+                param(2, m2) = param(0, m0) == param(1, m1);
+                pos_ += 4;
+                break;
+            case ADJUSTBASE:
+                relBase_ += param(0, m0);
+                pos_ += 2;
+                break;
+            case HALT:
+                halted_ = true;
+                return HALTED;
+            default:
+                throw std::runtime_error("constIntCode::run(): invalid "
+                                         "opcode");
+        }
+    }
+
+    return STEP_LIMIT;
+}
+
+
+// --- PRIVATE ---
+
+template<typename T, size_t M, size_t OUT>
+constexpr T & constIntCode<T, M, OUT>::cell(T addr) {
+    if (addr < 0 || size_t(addr) >= M) {
+        throw std::runtime_error("constIntCode: address outside the memory");
+    }
+
+    return memory_[size_t(addr)];
+}
+
+
+template<typename T, size_t M, size_t OUT>
+constexpr T & constIntCode<T, M, OUT>::param(int i, int mode) {
+    // parameter i of the instruction at pos_: the integer it refers to
+    // (position and relative mode) or the parameter itself (immediate mode)
+
+    T at = T(pos_ + 1 + i);
+
+    switch (mode) {
+        case POSITION: return cell(cell(at));
+        case IMMEDIATE: return cell(at);
+        case RELATIVE: return cell(cell(at) + relBase_);
+        default:
+            throw std::runtime_error("constIntCode: invalid parameter mode");
+    }
+}
+
+
+#endif // CONSTINTCODE_HPP
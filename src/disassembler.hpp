@@ -0,0 +1,406 @@
+#ifndef DISASSEMBLER_HPP
+#define DISASSEMBLER_HPP
+
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+
+
+/*
+Static view of an Intcode program: disassembles the image into instructions,
+splits them into basic blocks and connects the blocks to a control flow
+graph (CFG), without running the program.
+
+--- REACHABILITY ---
+
+Instructions are found by following the instruction flow from position 0
+(intCodeToCpp.cpp translates exactly these instructions): both branches of conditional jumps,
+jump targets given in immediate mode, and immediate values moved into memory
+(x + 0, x * 1) that point right behind an unconditional jump (return
+addresses pushed before a call). Everything else (data, unreachable code) is
+not disassembled, see isCode().
+
+--- BASIC BLOCKS ---
+
+A block starts at position 0, at every jump target, behind every jump and at
+every return address found above. It ends with a jump, a halt, an invalid
+instruction or in front of the next block start. block::next holds the start
+positions of the successors: the immediate jump target and/or the
+instruction behind the block. A negative immediate target is no successor
+(intCode stops with an error there). block::indirect is set for a jump whose target
+is read from memory (position or relative mode), those successors are not
+known statically.
+
+--- SELF-MODIFYING WRITES ---
+
+An instruction that writes (add, multiply, input, less, equal) to a constant
+address (position mode, or immediate mode: the parameter itself) inside a
+reachable instruction modifies code. Writes in relative mode are not
+resolved.
+
+--- CONSTRUCTOR ---
+
+# disassembler(const std::vector<T> & image)
+
+
+--- FUNCTIONS ---
+
+# const std::vector<instruction> & getInstructions() const
+- reachable instructions in address order (pos, opcode, mode[3], length,
+  param[3])
+
+# const std::vector<block> & getBlocks() const
+- basic blocks in address order (start, end: one past the last integer,
+  next, indirect)
+
+# const std::vector<write> & getSelfModifyingWrites() const
+- (pos, addr): the instruction at pos writes the code integer at addr
+
+# bool isCode(size_t pos) const, size_t blockAt(size_t pos) const
+- pos is an integer of a reachable instruction, index in getBlocks() of the
+  block containing pos (size_t(-1) if none)
+
+# void print(std::ostream & out) const
+- listing: one line per instruction, block headers with their successors,
+  self-modifying writes marked
+*/
+
+template<typename T>
+class disassembler {
+    public:
+        struct instruction {
+            size_t pos;
+            int opcode;
+            int mode[3];
+            size_t length;
+            T param[3];
+        };
+
+        struct block {
+            size_t start;
+            size_t end;
+            std::vector<size_t> next;
+            bool indirect;
+        };
+
+        struct write {
+            size_t pos;
+            size_t addr;
+        };
+
+        // Ctor
+        disassembler() = delete;
+        explicit disassembler(const std::vector<T> &);
+
+        // Getters
+        const std::vector<instruction> & getInstructions() const {
+            return instructions_;
+        }
+        const std::vector<block> & getBlocks() const { return blocks_; }
+        const std::vector<write> & getSelfModifyingWrites() const {
+            return writes_;
+        }
+        bool isCode(size_t pos) const {
+            return pos < blockOf_.size() && blockOf_[pos] != size_t(-1);
+        }
+        size_t blockAt(size_t pos) const {
+            return pos < blockOf_.size() ? blockOf_[pos] : size_t(-1);
+        }
+
+        // Public Member
+        void print(std::ostream &) const;
+        static std::string format(const instruction &);
+
+    private:
+        std::vector<T> image_;
+        std::vector<instruction> instructions_;
+        std::vector<block> blocks_;
+        std::vector<write> writes_;
+        std::vector<char> start_; // by position, an instruction starts here
+        std::vector<size_t> blockOf_; // by position
+
+        // Private Member
+        bool decode(size_t, instruction &) const;
+        void findInstructions(std::vector<char> &);
+        void buildBlocks(std::vector<char> &);
+        void findWrites();
+        static bool isJump(const instruction & ins) {
+            return ins.opcode == JUMPTRUE || ins.opcode == JUMPFALSE;
+        }
+        static bool isUnconditional(const instruction & ins) {
+            return isJump(ins) && ins.mode[0] == IMMEDIATE &&
+                   ((ins.opcode == JUMPTRUE) == (ins.param[0] != 0));
+        }
+
+        // Static Constants
+        static const int ADD = 1;
+        static const int MULTIPLY = 2;
+        static const int INPUT = 3;
+        static const int OUTPUT = 4;
+        static const int JUMPTRUE = 5;
+        static const int JUMPFALSE = 6;
+        static const int LESS = 7;
+        static const int EQUAL = 8;
+        static const int ADJUSTBASE = 9;
+        static const int HALT = 99;
+
+        static const int POSITION = 0;
+        static const int IMMEDIATE = 1;
+        static const int RELATIVE = 2;
+};
+
+
+// ------------------------
+// --- MEMBER FUNCTIONS ---
+// ------------------------
+
+// --- PUBLIC ---
+
+template<typename T>
+disassembler<T>::disassembler(const std::vector<T> & image) : image_(image) {
+    std::vector<char> leader(image_.size(), 0); // a block starts here
+
+    start_.assign(image_.size(), 0);
+    findInstructions(leader);
+
+    for (size_t p = 0; p < image_.size(); p++) {
+        if (start_[p]) {
+            instruction ins;
+            decode(p, ins);
+            instructions_.push_back(ins);
+        }
+    }
+
+    buildBlocks(leader);
+    findWrites();
+}
+
+
+template<typename T>
+void disassembler<T>::print(std::ostream & out) const {
+    std::vector<std::vector<size_t>> writesAt(image_.size());
+    for (const write & w: writes_) {
+        writesAt[w.pos].push_back(w.addr);
+    }
+
+    size_t b = 0;
+    for (const instruction & ins: instructions_) {
+        if (b < blocks_.size() && blocks_[b].start == ins.pos) {
+            out << "\nblock " << ins.pos << " -> ";
+            for (size_t n: blocks_[b].next) { out << n << " "; }
+            if (blocks_[b].indirect) { out << "(indirect)"; }
+            out << "\n";
+            b++;
+        }
+
+        out << "  " << ins.pos << ": " << format(ins);
+        for (size_t addr: writesAt[ins.pos]) {
+            out << "  ; modifies code at " << addr;
+        }
+        out << "\n";
+    }
+}
+
+
+template<typename T>
+std::string disassembler<T>::format(const instruction & ins) {
+    // "add [12], #3, [rb+4]": [a] position, #a immediate, [rb+a] relative
+
+    static const char * names[] = {
+        "???", "add", "mul", "in", "out", "jnz", "jz", "lt", "eq", "arb"
+    };
+
+    std::string res = ins.opcode == HALT ? "halt" :
+                      ins.opcode < 10 ? names[ins.opcode] : names[0];
+
+    for (size_t i = 0; i+1 < ins.length; i++) {
+        std::string val = std::to_string(ins.param[i]);
+        res += i == 0 ? " " : ", ";
+        res += ins.mode[i] == IMMEDIATE ? "#" + val :
+               ins.mode[i] == RELATIVE ? "[rb" + std::string(
+                   ins.param[i] < 0 ? "" : "+") + val + "]" :
+               "[" + val + "]";
+    }
+
+    return res;
+}
+
+
+// --- PRIVATE ---
+
+template<typename T>
+bool disassembler<T>::decode(size_t p, instruction & ins) const {
+    // decodes the instruction at p, false if it is invalid or does not fit
+    // into the image
+
+    if (p >= image_.size()) { return false; }
+
+    T word = image_[p];
+    ins.pos = p;
+    ins.opcode = int(word % 100);
+    ins.mode[0] = int(word / 100 % 10);
+    ins.mode[1] = int(word / 1000 % 10);
+    ins.mode[2] = int(word / 10000 % 10);
+
+    switch (ins.opcode) {
+        case ADD: case MULTIPLY: case LESS: case EQUAL:
+            ins.length = 4; break;
+        case JUMPTRUE: case JUMPFALSE:
+            ins.length = 3; break;
+        case INPUT: case OUTPUT: case ADJUSTBASE:
+            ins.length = 2; break;
+        case HALT:
+            ins.length = 1; break;
+        default:
+            return false;
+    }
+
+    if (word < 0 || p + ins.length > image_.size()) { return false; }
+
+    for (size_t i = 0; i < 3; i++) {
+        if (ins.mode[i] > RELATIVE) { return false; }
+        ins.param[i] = i+1 < ins.length ? image_[p+1+i] : 0;
+    }
+
+    return true;
+}
+
+
+template<typename T>
+void disassembler<T>::findInstructions(std::vector<char> & leader)
+{
+    // worklist over block starts, see REACHABILITY
+    // ---------------------
+
+    std::vector<size_t> todo{0};
+    std::vector<char> moved(image_.size(), 0); // immediates moved to memory
+    std::vector<char> afterJump(image_.size(), 0);
+    if (!image_.empty()) { leader[0] = 1; }
+
+    while (!todo.empty()) {
+        size_t p = todo.back();
+        todo.pop_back();
+
+        instruction ins;
+        while (decode(p, ins) && !start_[p]) {
+            start_[p] = 1;
+            size_t after = p + ins.length;
+
+            if (ins.opcode == HALT) { break; }
+
+            if (isJump(ins)) {
+                if (ins.mode[1] == IMMEDIATE && ins.param[1] >= 0 &&
+                    size_t(ins.param[1]) < image_.size())
+                {
+                    leader[ins.param[1]] = 1;
+                    todo.push_back(ins.param[1]);
+                }
+                if (after < image_.size()) { leader[after] = 1; }
+
+                if (isUnconditional(ins)) {
+                    if (after < image_.size()) { afterJump[after] = 1; }
+                    break;
+                }
+            } else if ((ins.opcode == ADD || ins.opcode == MULTIPLY) &&
+                       ins.mode[0] == IMMEDIATE && ins.mode[1] == IMMEDIATE)
+            {
+                // moving an immediate, e.g. a return address
+                T neutral = ins.opcode == ADD ? 0 : 1;
+                for (int i = 0; i < 2; i++) {
+                    T val = ins.param[i];
+                    if (ins.param[1-i] == neutral && val >= 0 &&
+                        size_t(val) < image_.size())
+                    {
+                        moved[val] = 1;
+                    }
+                }
+            }
+
+            p = after;
+        }
+
+        if (todo.empty()) {
+            for (size_t ret = 0; ret < image_.size(); ret++) {
+                if (moved[ret] && afterJump[ret] && !start_[ret]) {
+                    leader[ret] = 1;
+                    todo.push_back(ret);
+                }
+            }
+        }
+    }
+}
+
+
+template<typename T>
+void disassembler<T>::buildBlocks(std::vector<char> & leader) {
+    // cuts the instruction list at leaders and after jumps/halts and links
+    // the blocks, see BASIC BLOCKS
+    // ---------------------
+
+    blockOf_.assign(image_.size(), size_t(-1));
+
+    for (size_t i = 0; i < instructions_.size(); i++) {
+        const instruction & ins = instructions_[i];
+
+        bool cut = blocks_.empty() || leader[ins.pos] ||
+                   blocks_.back().end != ins.pos;
+        if (!cut) {
+            const instruction & prev = instructions_[i-1];
+            cut = isJump(prev) || prev.opcode == HALT;
+        }
+        if (cut) {
+            blocks_.push_back(block{ins.pos, ins.pos, {}, false});
+        }
+
+        block & b = blocks_.back();
+        b.end = ins.pos + ins.length;
+        for (size_t p = ins.pos; p < b.end; p++) {
+            if (blockOf_[p] == size_t(-1)) { blockOf_[p] = blocks_.size()-1; }
+        }
+    }
+
+    // successors from the last instruction of every block
+    size_t i = 0;
+    for (block & b: blocks_) {
+        while (instructions_[i].pos + instructions_[i].length < b.end) { i++; }
+        const instruction & last = instructions_[i++];
+
+        if (last.opcode == HALT) { continue; }
+
+        if (isJump(last)) {
+            if (last.mode[1] != IMMEDIATE) {
+                b.indirect = true;
+            } else if (last.param[1] >= 0) { // negative: no successor
+                b.next.push_back(size_t(last.param[1]));
+            }
+            if (isUnconditional(last)) { continue; }
+        }
+
+        if (b.end < image_.size() && start_[b.end]) {
+            b.next.push_back(b.end);
+        }
+    }
+}
+
+
+template<typename T>
+void disassembler<T>::findWrites() {
+    for (const instruction & ins: instructions_) {
+        int out = ins.opcode == INPUT ? 0 :
+                  (ins.length == 4 && !isJump(ins)) ? 2 : -1;
+        if (out < 0) { continue; }
+
+        T addr = ins.mode[out] == IMMEDIATE ? T(ins.pos+1+out) :
+                 ins.mode[out] == POSITION ? ins.param[out] : T(-1);
+
+        if (addr >= 0 && isCode(size_t(addr))) {
+            writes_.push_back(write{ins.pos, size_t(addr)});
+        }
+    }
+}
+
+
+#endif // DISASSEMBLER_HPP
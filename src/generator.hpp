@@ -0,0 +1,163 @@
+#ifndef GENERATOR_HPP
+#define GENERATOR_HPP
+
+
+#include <vector>
+#include <iterator>
+#include <cstddef>
+
+#include "intCode.hpp"
+#include "channel.hpp"
+
+
+/*
+Drives an intCode as a generator: the program yields its outputs one at a
+time and awaits inputs, the caller pulls outputs and sends inputs in plain
+straight-line code instead of re-entering runIntCode() with stopAtInput /
+stopAtOutput and copying getOutput() vectors, e.g. day 11:
+
+    generator<long> robot(code);
+    robot.send(0);
+    long color, turn;
+    while (robot.next(color) && robot.next(turn)) {
+        ... paint, turn, move ...
+        robot.send(colorBelow);
+    }
+
+The machine runs on the channel overload of runIntCode() with an output
+channel of capacity one: it stops in front of the output instruction after
+the one delivered (or in front of an input instruction with no input sent,
+or at the end), so it never runs ahead of the caller by more than one
+output. Resuming is a single call into the instruction loop, nothing is
+reset and no vector is copied; values pass through the fixed ring buffers of
+the channels.
+
+(A C++20 coroutine (co_yield / co_await) would offer the same interface, the
+code base is C++17: the suspension points are the blocked input and output
+instructions of the machine itself.)
+
+--- CONSTRUCTOR ---
+
+# generator(const std::vector<T> & code), generator(intCode<T, D> vm)
+- Arguments:
+    code - program, run from position 0
+    vm - machine continuing where it stands (stopAtInput, stopAtOutput and
+         printInOut do not apply)
+
+
+--- FUNCTIONS ---
+
+# bool next(T & out)
+- runs the program until its next output
+- Returns:
+    true with the output in out, false if the program halted or awaits an
+    input that was not sent (see isHalted())
+
+# int resume()
+- same as next(), returns OUTPUT (value() holds it), WAITING or HALTED
+
+# bool send(const T & in)
+- queues an input for the input instructions, oldest first
+- Returns:
+    false if INPUTS inputs are queued already (in is dropped)
+
+# T value() const, bool isHalted() const, size_t getPending() const
+- last output returned, the program halted, inputs sent but not read yet
+
+# begin(), end()
+- input iterators over the outputs up to the next input the program awaits
+  (or its end): for (long val: gen) { ... }
+
+# generator fork() const
+- independent copy (the machine is forked copy-on-write, see intCode::fork(),
+  sent inputs and pending outputs are copied)
+
+# intCode<T, D> & machine(), const intCode<T, D> & machine() const
+- the machine, e.g. for getStateHash() or getMemory()
+*/
+
+template<typename T, typename D = threadedDispatch>
+class generator {
+    public:
+        class iterator {
+            public:
+                typedef std::input_iterator_tag iterator_category;
+                typedef T value_type;
+                typedef std::ptrdiff_t difference_type;
+                typedef const T * pointer;
+                typedef const T & reference;
+
+                explicit iterator(generator * gen = nullptr) :
+                        gen_(gen), val_(0)
+                {
+                    ++(*this);
+                }
+                const T & operator*() const { return val_; }
+                iterator & operator++() {
+                    if (gen_ && !gen_->next(val_)) { gen_ = nullptr; }
+                    return *this;
+                }
+                bool operator==(const iterator & o) const {
+                    return gen_ == o.gen_;
+                }
+                bool operator!=(const iterator & o) const {
+                    return gen_ != o.gen_;
+                }
+
+            private:
+                generator * gen_; // nullptr: end
+                T val_;
+        };
+
+        // Ctor
+        generator() = delete;
+        explicit generator(const std::vector<T> & code) :
+                generator(intCode<T, D>(code))
+        {}
+        explicit generator(intCode<T, D> vm) :
+                vm_(std::move(vm)), in_(INPUTS), out_(1), value_(0),
+                halted_(false)
+        {}
+
+        // Getters
+        T value() const { return value_; }
+        bool isHalted() const { return halted_ && out_.empty(); }
+        size_t getPending() const { return in_.size(); }
+        intCode<T, D> & machine() { return vm_; }
+        const intCode<T, D> & machine() const { return vm_; }
+
+        // Public Member
+        int resume() {
+            if (out_.empty() && !halted_) {
+                halted_ = vm_.runIntCode(in_, out_);
+            }
+            if (out_.pop(value_)) { return OUTPUT; }
+            return halted_ ? HALTED : WAITING;
+        }
+        bool next(T & out) {
+            if (resume() != OUTPUT) { return false; }
+            out = value_;
+            return true;
+        }
+        bool send(const T & in) { return in_.push(in); }
+        iterator begin() { return iterator(this); }
+        iterator end() { return iterator(); }
+        generator fork() const { return *this; }
+
+        // Static Constants
+        static const int OUTPUT = 0; // return values of resume()
+        static const int WAITING = 1;
+        static const int HALTED = 2;
+
+        static const size_t INPUTS = 64; // inputs queued at most
+
+    private:
+        intCode<T, D> vm_;
+        channel<T> in_;
+        channel<T> out_;
+        T value_;
+        bool halted_;
+};
+
+
+#endif // GENERATOR_HPP
@@ -6,7 +6,18 @@
 #include <fstream>
 #include <string>
 #include <vector>
+#include <memory>
+#include <algorithm>
+#include <cstdint>
 #include <cassert>
+#include <atomic>
+#include <stdexcept>
+#include <utility>
+
+#include "pagedMemory.hpp"
+#include "intCodeImage.hpp"
+#include "channel.hpp"
+#include "profiler.hpp"
 
 
 /*
@@ -15,13 +26,37 @@ the first of which is the instruction (containing operation code and parameter
 modes). The other integers are the set's parametes on which the operation is
 performed
 
+--- TEMPLATE PARAMETERS ---
+
+# intCode<T, D = threadedDispatch, P = noProfiler>
+    T - signed integer type of the int code (int, long, long long)
+    D - dispatch policy, selects the instruction loop of runIntCode()
+        switchDispatch: switch on the opcode
+        threadedDispatch (default): direct-threaded loop (GCC/Clang labels
+                          as values, falls back to switchDispatch on other
+                          compilers)
+        compiledDispatch: translates each basic block into a sequence of
+                          micro-ops the first time it is entered, see
+                          COMPILED BACKEND below (including
+                          superinstructions)
+        All produce identical results; benchIntCode.cpp compares them. With
+        g++ -O2, threaded dispatch takes 6.8-7.9 ms against 7.7-8.9 ms for
+        switch on day 9 and 13.1-14.4 ms against 15.3-16.6 ms on day 13, so
+        it is the default (where labels as values are missing it is the
+        switch loop anyway)
+    P - profiling policy, see profiler.hpp
+        noProfiler (default): no profiling, costs nothing
+        profiler: counts instructions per opcode, address and basic block
+                  and the returns at input/output, see getProfile()
+
+
 --- CONSTRUCTOR ---
 - no default constructor
 - constructor must be provided at least one argument, namely the int code
 
 # intCode(std::vector<T> code, bool stopAtOutput = false,
           bool stopAtInput = false, bool printInOut = false,
-          size_t pos = 0)
+          size_t pos = 0, T relBase = 0)
 - Arguments:
     code - int code containing all instruction sets, the program if you want
     stopAtOutput - false (default): lets runIntCode() continue program
@@ -38,32 +73,180 @@ performed
                   generates
     pos - lets runIntCode() start at a position in the program (series of
           instruction sets) different from 0 (default)
+    relBase - initial relative base, lets a program be resumed by another
+              intCode (e.g. code generated by intCodeToCpp)
+
+# intCode(const intCodeImage<T> & image, bool stopAtOutput = false, ...)
+- same as above, the program is a binary image (see intCodeImage.hpp). The
+  memory pages of a mapped image are not copied until the program writes to
+  them, the machine (and its copies) keep the mapping alive
+
+# intCode(std::istream & in)
+- restores a machine written by save(): it continues exactly where the saved
+  one stood. Throws std::runtime_error if in does not hold a version 1
+  checkpoint of this integer type or is truncated
 
 
 --- FUNCTIONS ---
 
 # bool runIntCode(const std::vector<T> & IN)
 - Arguments:
-    IN (optional): If no input vector is provided, an empty vector is passed as
-    arguement via a helper function
+    IN (optional): If no input vector is provided, no input is passed and every
+    input instruction prompts for input via std::cin. A single input can be
+    passed as scalar. Neither of the overloads copies the input
 - Returns:
     boolean that is true IFF the int program was halted (only happens at the
     finish of the program), else returns false
 
+# bool runIntCode(channel<T> & in, channel<T> & out)
+- Arguments:
+    in - input instructions pop their value from in
+    out - output instructions push their value to out (getOutput() is left
+          untouched)
+    The same channel may be passed as out of one machine and in of another
+    (chained machines, see main07.cpp)
+- Returns:
+    true IFF the program was halted. Otherwise the machine is blocked: it
+    stands in front of an input instruction while in is empty or in front of
+    an output instruction while out is full, and continues there on the next
+    call. stopAtOutput and stopAtInput do not apply to this overload
+
+# int run(channel<T> & in, channel<T> & out, size_t maxInstructions)
+- same as runIntCode(in, out), returns after at most maxInstructions
+  instructions (a time slice, e.g. for scheduler.hpp). The next call
+  continues in front of the next instruction as if it had not returned
+- Returns:
+    FINISHED - the program halted
+    BLOCKED - in front of an input instruction while in is empty or an output
+              instruction while out is full
+    EXHAUSTED - maxInstructions were executed, the program neither halted
+                nor blocked
+    (reaching the limit of setInstructionLimit() first returns BLOCKED, like
+    runIntCode() returning false)
+
+# T getMemory(size_t addr)
+- Returns:
+    integer at memory address addr (0 if never written), without copying the
+    whole memory like getCode()
+
+# size_t getMemorySize() const, size_t getImageSize() const
+- Returns:
+    size of the memory (getCode().size()) and of the original program
+
+# template<typename F> void forEachPage(F f) const
+- calls f(num, cells) for every memory page ever written: page number num
+  and its pagedMemory<T>::PAGE_SIZE integers cells (const T *), without
+  copying the memory like getCode(). Copies (fork(), snapshot()) share the
+  cells of the pages neither of them wrote since
+
+# size_t getInstructionCount()
+- Returns:
+    number of instructions executed so far (an input or output instruction
+    the machine stopped in front of is not counted)
+
+# void setInstructionLimit(size_t n)
+- Arguments:
+    n - runIntCode() also returns (false, not halted) in front of the next
+        instruction once n more instructions have been executed, the next
+        call continues there. size_t(-1) removes the limit (default)
+
+# bool isAtLimit() const
+- the machine stands at the limit of setInstructionLimit(): runIntCode()
+  returns right away until the limit is raised
+
+# void setFusion(bool on)
+- Arguments:
+    on - true: compiledDispatch translates frequent instruction pairs into
+         superinstructions, see COMPILED BACKEND. false (default): one
+         micro-op per instruction (the same results). Discards the
+         translated blocks; switch and threaded dispatch are not affected
+
+# void setStateHashing(bool on), uint64_t getStateHash() const
+- 64-bit hash of the machine state: memory, position and relative base
+  (outputs and inputs not consumed yet are not part of it). Equal states
+  have equal hashes; different states collide with probability 2^-64 per
+  pair, see visitedSet.hpp to prune states a search has seen before
+- with setStateHashing(true) the memory part is kept up to date on every
+  write (O(1) per write, an XOR of the old and the new value of the integer
+  hashed with its address), getStateHash() then costs O(1). Otherwise (the
+  default, writes cost nothing extra) getStateHash() hashes the whole memory.
+  Copies (fork(), snapshot()) keep hashing and their current hash
+
+# const P & getProfile() const
+- Returns:
+    the profiling policy with everything recorded so far
+
+# size_t getAllocationCount()
+- Returns:
+    number of heap allocations performed by runIntCode() so far (memory pages
+    and the output buffer, with compiledDispatch also the translated blocks
+    and their tables). Executing instructions does not allocate, so this
+    only increases while new memory pages are still being touched (or shared
+    pages are written for the first time, see fork()) and, with
+    compiledDispatch, while code is translated for the first time.
+    checkAllocations.cpp checks it against the allocations actually done
+
+# intCode fork() const, intCode snapshot() const
+- Returns:
+    independent copy of the machine (memory, position, relative base,
+    outputs). Memory pages, the decoded instructions and the translated
+    blocks are shared copy-on-write with the original, so the copy costs
+    O(1) in the size of the program (one pointer per 512 integers of memory)
+    and each side duplicates a page only when it first writes to it. fork()
+    and snapshot() are the same operation, the names state the intent: fork
+    to explore another input sequence, snapshot to go back later
+
+# void restore(const intCode & snap)
+- Arguments:
+    snap - machine obtained from snapshot() (or any other copy), this machine
+           continues exactly where snap stands
+
+# void patch(size_t addr, T val)
+- writes val to memory address addr before (or between) runs, e.g. noun and
+  verb of day 2 on a fork of a common machine
+
+# void setPosition(size_t pos, T relBase)
+- the next run continues at pos with relative base relBase, e.g. to rebuild
+  a recorded state (see trace.hpp)
+
+# void save(std::ostream & out) const
+- writes the state of the machine as a checkpoint (e.g. to a file opened
+  with std::ios::binary) that intCode(std::istream &) restores, so a long
+  run that is killed can be resumed instead of recomputed
+- binary checkpoint format, version 1: "ICCK", then 64-bit little-endian
+  fields: version, sizeof(T), flags (1 stopAtOutput, 2 stopAtInput,
+  4 printInOut, 8 stopped at input, 16 state hashing, 32 fusion), position,
+  relative base, inputs consumed in the current run, last input,
+  instructions executed, size of the original program, memory size, the
+  pending outputs (count, values) and the memory pages that hold anything
+  but 0 (count, then page number and 512 integers of sizeof(T) bytes each).
+  The pages are copied as they are, restoring costs about as much as reading
+  the file. Not saved: the profile, the instruction limit, translated
+  blocks (retranslated on demand)
+
 
 --- WORKING PRINCIPLE ---
 
 - Int program is initialized with constructor that sets all member variables
 - runIntCode() loops through the instrucion sets (incrementing the position
   count by the number of integers in each respective set)
+- every integer of the program is pre-decoded once into an instruction
+  record (operation code, the three parameter modes, the step size and the
+  integer it was decoded from), 512 integers at a time when the first
+  instruction among them is executed, so construction does not depend on the
+  size of the program. The records are never changed afterwards (all copies
+  share them); a record whose integer was overwritten (self-modifying code)
+  no longer matches memory and the instruction is decoded on the fly instead
 - for each instruction set
-    - reads instruction (operation code + parameter modes of all parameters)
-    - sets operation code dependent step size (increment of position count,
-      i.e, where is the next instruction that must be read after this one)
-    - sets all parameter modes AND if the index of any of the parameters to be
-      read lies outside the range of the code size, the function
-      setParameterMode() appends as many 0's (zeros) to the code vector as
-      necessary in order to avoid false memory access.
+    - looks up the pre-decoded instruction (operation code + parameter modes of
+      all parameters + operation code dependent step size, i.e, where is the
+      next instruction that must be read after this one)
+    - reads all parameter values (fixed-size array on the stack) and
+      resolves the address written to, if any. Memory is a pagedMemory (see
+      pagedMemory.hpp): any address beyond the original program lives in a
+      zero-initialized page that is allocated on first write, so far writes
+      neither reallocate nor fill a dense vector up to the address. Only the
+      written address can duplicate a page shared with a fork
     - finally executes operation (depending on operation code) on the
       previously set parameters
     - OPTIONAL: - program execution stops at output if stopAtOutput_ = true,
@@ -73,9 +256,49 @@ performed
                   program execution would be caught in an infinite loop of
                   stopping at the same input instruction over and over)
                 - program prints all outputs if printInOut_ = true
+
+
+--- COMPILED BACKEND (compiledDispatch) ---
+
+- a basic block is the run of instructions starting at some position of the
+  original program up to and including the next jump, or up to the next
+  input, output or halt instruction (those are always interpreted)
+- the first time execution reaches the start of a block, every instruction of
+  the block is translated into a micro-op: a pointer to a handler specialized
+  for opcode and parameter modes, plus the parameters taken from the code
+  (immediate values, positions, relative offsets). Executing a micro-op needs
+  neither decoding nor a mode switch
+- positions for which no block can be built (beyond the original program,
+  or starting with input/output/halt) are interpreted one instruction at a
+  time exactly like switchDispatch, which keeps the stop-at-input and
+  stop-at-output semantics unchanged
+- a write to any integer that was translated into a micro-op (self-modifying
+  code) discards all blocks and flags the integer. Instructions containing a
+  flagged integer are never translated again but interpreted, so the program
+  sees the written value
+- copies of an intCode share the table of translated blocks; a copy that
+  translates or discards a block first makes the table its own
+- superinstructions: an add, less or equal followed by a conditional jump
+  with an immediate target that tests the integer just written (the same
+  position, or the same offset in relative mode) is translated into a single
+  micro-op. It computes the result, writes it (later reads of the integer see
+  it) and takes the jump on the value it already holds, saving a dispatch and
+  a load. This is the code compilers emit for if/while conditions: 20% of
+  the day 9 and 37% of the day 15 instructions run within superinstructions.
+  They are off unless setFusion(true) is called: benchIntCode.cpp reports hit
+  rates and times, and the speedup is not reproducible (from 0.93x to 1.2x
+  from one run to the next on the days 9, 11, 13 and 15). If the write
+  discards the block (self-modifying code), the superinstruction stops in
+  front of the jump, which then executes on its own
 */
 
-template<typename T>
+// Dispatch policies, select the instruction loop of runIntCode()
+struct switchDispatch {};   // switch on the opcode
+struct threadedDispatch {}; // direct-threaded (labels as values, GCC/Clang)
+struct compiledDispatch {}; // basic blocks translated into micro-ops
+
+
+template<typename T, typename D = threadedDispatch, typename P = noProfiler>
 class intCode {
     public:
         static_assert(std::is_same<int, T>::value ||
@@ -86,30 +309,126 @@ class intCode {
 
         // Ctor
         intCode() = delete;
+        explicit intCode(std::istream & in) : intCode(readCheckpoint(in), in)
+        {}
         intCode(std::vector<T> code, bool stopAtOutput = false,
                 bool stopAtInput = false, bool printInOut = false,
-                size_t pos = 0) :
+                size_t pos = 0, T relBase = 0) :
                 code_(code), stopAtOutput_(stopAtOutput),
                 stopAtInput_(stopAtInput), printInOut_(printInOut),
-                pos_(pos), input_(0), inputCount_(0), relBase_(0),
-                stopped_(false)
+                pos_(pos), input_(0), inputCount_(0), relBase_(relBase),
+                inCh_(nullptr), outCh_(nullptr), stopped_(false),
+                allocations_(0), executed_(0), limit_(size_t(-1)),
+                hashing_(false), memHash_(0), old_(0), fusion_(false),
+                abort_(false)
+        {
+            lastOut_.resize(0);
+            setupDecoding(code.size());
+        }
+        explicit intCode(const intCodeImage<T> & image,
+                         bool stopAtOutput = false, bool stopAtInput = false,
+                         bool printInOut = false, size_t pos = 0,
+                         T relBase = 0) :
+                code_(image.data(), image.size(), image.owner()),
+                stopAtOutput_(stopAtOutput), stopAtInput_(stopAtInput),
+                printInOut_(printInOut), pos_(pos), input_(0), inputCount_(0),
+                relBase_(relBase), inCh_(nullptr), outCh_(nullptr),
+                stopped_(false), allocations_(0), executed_(0),
+                limit_(size_t(-1)), hashing_(false), memHash_(0), old_(0),
+                fusion_(false), abort_(false)
         {
             lastOut_.resize(0);
+            setupDecoding(image.size());
         }
 
         // Getters
         size_t getPosition() const { return pos_; }
-        std::vector<T> getCode() const { return code_; }
+        T getRelativeBase() const { return relBase_; }
+        std::vector<T> getCode() const { return code_.toVector(); }
+        T getMemory(size_t addr) const { return code_.read(addr); }
+        size_t getMemorySize() const { return code_.size(); }
+        size_t getImageSize() const { return code_.getImageSize(); }
+        template<typename F> void forEachPage(F f) const {
+            code_.forEachPage(f);
+        }
         std::vector<T> getOutput() const { return lastOut_; }
         T getSingleOutput() const { return lastOut_[0]; }
+        size_t getAllocationCount() const {
+            return allocations_ + code_.getAllocationCount();
+        }
+        size_t getInstructionCount() const { return executed_; }
+        void setInstructionLimit(size_t n) {
+            limit_ = n > size_t(-1) - executed_ ? size_t(-1) : executed_ + n;
+        }
+        bool isAtLimit() const { return executed_ == limit_; }
+        void setStateHashing(bool);
+        uint64_t getStateHash() const;
+        void setFusion(bool on) {
+            fusion_ = on;
+            blocks_.reset();
+        }
+        const P & getProfile() const { return profile_; }
 
         // Public Member
         bool runIntCode(const std::vector<T> &);
         bool runIntCode(const T &);
         bool runIntCode();
+        bool runIntCode(channel<T> &, channel<T> &);
+        int run(channel<T> &, channel<T> &, size_t);
+        intCode fork() const { return *this; }
+        intCode snapshot() const { return *this; }
+        void restore(const intCode & snap) { *this = snap; }
+        void patch(size_t, T);
+        void setPosition(size_t pos, T relBase) {
+            pos_ = pos;
+            relBase_ = relBase;
+        }
+        void save(std::ostream &) const;
+
+        // Static Constants
+        static const int FINISHED = 0; // return values of run()
+        static const int BLOCKED = 1;
+        static const int EXHAUSTED = 2;
 
     private:
-        std::vector<T> code_;
+        // pre-decoded instruction word, see decode()
+        struct instruction {
+            int opcode;
+            int mode[3];
+            size_t step;
+            int handler; // dense opcode index for threadedDispatch
+            T word; // integer the record was decoded from
+        };
+
+        struct decodeTable {
+            // records of the original program, decoded DECODE_CHUNK at a
+            // time by whichever copy needs them first. state of a chunk:
+            // 0 not decoded, 1 being decoded, 2 decoded. The records are
+            // allocated but not touched before, so large programs cost no
+            // time until they run
+            std::unique_ptr<instruction[]> records;
+            std::unique_ptr<std::atomic<char>[]> state;
+            size_t size;
+
+            explicit decodeTable(size_t n) :
+                    records(new instruction[n]),
+                    state(new std::atomic<char>[n / DECODE_CHUNK + 1]),
+                    size(n)
+            {
+                for (size_t c = 0; c <= n / DECODE_CHUNK; c++) {
+                    state[c].store(0, std::memory_order_relaxed);
+                }
+            }
+        };
+
+        pagedMemory<T> code_;
+        std::shared_ptr<decodeTable> decoded_;
+        const instruction * records_; // decoded_->records
+        std::atomic<char> * ready_; // decoded_->state
+        size_t decodedSize_; // decoded_->size
+        const instruction * instr_; // instruction currently executed
+        instruction fetched_; // decoded on the fly, beyond original program
+        size_t target_; // address written by the instruction, see target()
         bool stopAtOutput_;
         bool stopAtInput_;
         bool printInOut_;
@@ -118,12 +437,100 @@ class intCode {
         size_t inputCount_;
         T relBase_;
         std::vector<T> lastOut_;
-        std::vector<int> paraMode_;
+        channel<T> * inCh_; // set during runIntCode(channel, channel) only
+        channel<T> * outCh_;
         bool stopped_;
+        size_t allocations_;
+        size_t executed_; // number of instructions executed
+        size_t limit_; // stop in front of the next instruction at this count
+        bool hashing_; // keep memHash_ up to date, see setStateHashing()
+        uint64_t memHash_; // XOR of cellHash() over all integers != 0
+        T old_; // value at target_ before the write (hashing_ only)
+        P profile_;
+
+        // compiledDispatch: translated basic blocks, see COMPILED BACKEND
+        struct microOp {
+            void (*run)(intCode &, const microOp &);
+            T arg[4]; // arg[3]: jump target of a superinstruction
+            size_t next; // position of the following instruction
+            size_t count; // instructions, 2 for a superinstruction
+        };
+        struct block {
+            std::vector<microOp> ops;
+            size_t count; // instructions
+        };
+        typedef void (*handler)(intCode &, const microOp &);
+
+        struct blockTable {
+            std::vector<std::shared_ptr<const block>> blocks; // by position
+            std::vector<char> compiled; // integer was translated into a micro-op
+            std::vector<char> modified; // ... and written to afterwards
+        };
+
+        std::shared_ptr<blockTable> blocks_; // shared by copies, see compile()
+        std::shared_ptr<const blockTable> retired_;
+        bool fusion_; // translate superinstructions
+        bool abort_; // current block was discarded, stop executing it
+
+        struct checkpoint {
+            // fixed-size part of a saved machine, see save()
+            uint64_t flags;
+            size_t pos;
+            T relBase;
+            size_t inputCount;
+            T input;
+            size_t executed;
+            size_t imageSize;
+            size_t size;
+        };
+
+        intCode(const checkpoint &, std::istream &);
 
         // Private Member
-        void getParameterMode();
-        void setParameterMode(std::vector<T *> &);
+        void setupDecoding(size_t n) {
+            decoded_ = std::make_shared<decodeTable>(n);
+            records_ = decoded_->records.get();
+            ready_ = decoded_->state.get();
+            decodedSize_ = n;
+        }
+        size_t tableAllocations() const {
+            // a blockTable of decoded_->size entries: the table and its
+            // three vectors
+            return decoded_->size > 0 ? 4 : 1;
+        }
+        static checkpoint readCheckpoint(std::istream &);
+        static void putField(std::ostream &, uint64_t);
+        static uint64_t getField(std::istream &);
+        static bool littleEndian() {
+            const uint16_t one = 1;
+            return *reinterpret_cast<const unsigned char *>(&one) == 1;
+        }
+        bool run(const T *, size_t);
+        bool execute(const T *, size_t, switchDispatch);
+        bool execute(const T *, size_t, threadedDispatch);
+        int step(const T *, size_t);
+        bool execute(const T *, size_t, compiledDispatch);
+        const block & compile(size_t);
+        bool fuse(size_t, const instruction &, microOp &);
+        void discardBlocks(size_t);
+        template<int OP, int M0, int M1, int M2>
+        static void runOp(intCode &, const microOp &);
+        template<int M> T load(const microOp &, int);
+        template<int M> void store(const microOp &, int, T);
+        template<int OP> static handler selectOp(int, int, int);
+        template<int OP, int M0> static handler selectOp2(int, int);
+        template<int OP, int M0, int M1> static handler selectOp3(int);
+        bool input(const T *, size_t);
+        bool output();
+        bool halt();
+        bool invalidOpcode();
+        static instruction decode(T);
+        const instruction & predecode(T);
+        const instruction & fetch();
+        T * write(size_t);
+        void invalidate();
+        template<size_t N> void setParameterMode(T (&)[N]);
+        T * target(size_t);
         void modify1();
         void modify2();
         void modify3();
@@ -133,6 +540,12 @@ class intCode {
         void modify7();
         void modify8();
         void modify9();
+        uint64_t hashMemory() const;
+        static uint64_t mix(uint64_t);
+        static uint64_t cellHash(size_t addr, T val) {
+            // 0 for val == 0, so never written memory adds nothing
+            return val != 0 ? mix(uint64_t(val) ^ mix(addr + 1)) : 0;
+        }
 
         // Static Constants
         static const int ADD = 1;
@@ -146,9 +559,28 @@ class intCode {
         static const int ADJUSTBASE = 9;
         static const int HALT = 99;
 
+        // micro-ops of superinstructions: opcode of the first instruction +
+        // FUSEDTRUE (followed by a jump if true) or FUSEDFALSE (if false)
+        static const int FUSEDTRUE = 100;
+        static const int FUSEDFALSE = 200;
+
+        static const int RUNNING = 0; // return values of step()
+        static const int STOPPED = 1;
+        static const int HALTED = 2;
+
         static const int POSITION = 0;
         static const int IMMEDIATE = 1;
         static const int RELATIVE = 2;
+
+        static const size_t DECODE_CHUNK = 512; // records decoded at a time
+
+        static const int CHECKPOINT_VERSION = 1; // see save()
+        static const uint64_t FLAG_STOPATOUTPUT = 1; // checkpoint flags
+        static const uint64_t FLAG_STOPATINPUT = 2;
+        static const uint64_t FLAG_PRINTINOUT = 4;
+        static const uint64_t FLAG_STOPPED = 8;
+        static const uint64_t FLAG_HASHING = 16;
+        static const uint64_t FLAG_FUSION = 32;
 };
 
 
@@ -158,13 +590,260 @@ class intCode {
 
 // --- PUBLIC ---
 
-template<typename T>
-bool intCode<T>::runIntCode(const std::vector<T> & in) {
+template<typename T, typename D, typename P>
+bool intCode<T, D, P>::runIntCode(const std::vector<T> & in) {
     // return true IFF program was halted (opcode 99), false otherwise
+
+    return run(in.data(), in.size());
+}
+
+
+template<typename T, typename D, typename P>
+bool intCode<T, D, P>::runIntCode(const T & in) {
+    // Allows for passing of single input as scalar
+
+    return run(&in, 1);
+}
+
+
+template<typename T, typename D, typename P>
+bool intCode<T, D, P>::runIntCode() {
+    // No input provided. Prompts a manual input via std::cin for any input
+    // instruction
+
+    return run(nullptr, 0);
+}
+
+
+template<typename T, typename D, typename P>
+bool intCode<T, D, P>::runIntCode(channel<T> & in, channel<T> & out) {
+    // runs until halted or blocked on an empty in / a full out
+
+    inCh_ = &in;
+    outCh_ = &out;
+    profile_.resume();
+    bool halted = execute(nullptr, 0, D());
+    inCh_ = nullptr;
+    outCh_ = nullptr;
+
+    return halted;
+}
+
+
+template<typename T, typename D, typename P>
+int intCode<T, D, P>::run(channel<T> & in, channel<T> & out,
+                          size_t maxInstructions) {
+    // runIntCode(in, out) under a limit of maxInstructions more instructions
+    // (unless the one set by setInstructionLimit() comes first). The limit
+    // is checked in front of every instruction, so the machine stops on an
+    // instruction boundary
+
+    size_t limit = limit_;
+    bool budget = maxInstructions <= limit_ - executed_;
+    if (budget) { limit_ = executed_ + maxInstructions; }
+
+    bool halted = runIntCode(in, out);
+    bool exhausted = budget && executed_ == limit_;
+    limit_ = limit;
+
+    if (halted) { return FINISHED; }
+    return exhausted ? EXHAUSTED : BLOCKED;
+}
+
+
+template<typename T, typename D, typename P>
+void intCode<T, D, P>::patch(size_t addr, T val) {
+    // same bookkeeping as a write by the program itself
+
+    *write(addr) = val;
+    invalidate();
+}
+
+
+template<typename T, typename D, typename P>
+void intCode<T, D, P>::save(std::ostream & out) const {
+    // see save() above for the format. Pages are written as they are in
+    // memory on little-endian machines
+    // -----------------
+
+    std::vector<std::pair<size_t, const T *>> pages;
+    code_.forEachPage([&](size_t num, const T * cells) {
+        for (size_t i = 0; i < pagedMemory<T>::PAGE_SIZE; i++) {
+            if (cells[i] != 0) {
+                pages.push_back({num, cells});
+                break;
+            }
+        }
+    });
+
+    uint64_t flags = (stopAtOutput_ ? FLAG_STOPATOUTPUT : 0) |
+                     (stopAtInput_ ? FLAG_STOPATINPUT : 0) |
+                     (printInOut_ ? FLAG_PRINTINOUT : 0) |
+                     (stopped_ ? FLAG_STOPPED : 0) |
+                     (hashing_ ? FLAG_HASHING : 0) |
+                     (fusion_ ? FLAG_FUSION : 0);
+
+    out.write("ICCK", 4);
+    putField(out, CHECKPOINT_VERSION);
+    putField(out, sizeof(T));
+    putField(out, flags);
+    putField(out, pos_);
+    putField(out, uint64_t(relBase_));
+    putField(out, inputCount_);
+    putField(out, uint64_t(input_));
+    putField(out, executed_);
+    putField(out, code_.getImageSize());
+    putField(out, code_.size());
+
+    putField(out, lastOut_.size());
+    for (const T & val: lastOut_) { putField(out, uint64_t(val)); }
+
+    putField(out, pages.size());
+    for (const auto & p: pages) {
+        putField(out, p.first);
+        if (littleEndian()) {
+            out.write(reinterpret_cast<const char *>(p.second),
+                      pagedMemory<T>::PAGE_SIZE * sizeof(T));
+            continue;
+        }
+        for (size_t i = 0; i < pagedMemory<T>::PAGE_SIZE; i++) {
+            for (size_t b = 0; b < sizeof(T); b++) {
+                out.put(char(uint64_t(p.second[i]) >> (8*b)));
+            }
+        }
+    }
+}
+
+
+template<typename T, typename D, typename P>
+void intCode<T, D, P>::setStateHashing(bool on) {
+    if (on && !hashing_) { memHash_ = hashMemory(); }
+    hashing_ = on;
+}
+
+
+template<typename T, typename D, typename P>
+uint64_t intCode<T, D, P>::getStateHash() const {
+    uint64_t mem = hashing_ ? memHash_ : hashMemory();
+
+    return mem ^ mix(pos_ ^ 0x5bd1e9955bd1e995) ^
+           mix(uint64_t(relBase_) ^ 0xc2b2ae3d27d4eb4f);
+}
+
+
+// --- PRIVATE ---
+
+template<typename T, typename D, typename P>
+intCode<T, D, P>::intCode(const checkpoint & c, std::istream & in) :
+        code_(c.imageSize, c.size),
+        stopAtOutput_(c.flags & FLAG_STOPATOUTPUT),
+        stopAtInput_(c.flags & FLAG_STOPATINPUT),
+        printInOut_(c.flags & FLAG_PRINTINOUT), pos_(c.pos), input_(c.input),
+        inputCount_(c.inputCount), relBase_(c.relBase), inCh_(nullptr),
+        outCh_(nullptr), stopped_(c.flags & FLAG_STOPPED), allocations_(0),
+        executed_(c.executed), limit_(size_t(-1)), hashing_(false),
+        memHash_(0), old_(0), fusion_(c.flags & FLAG_FUSION), abort_(false)
+{
+    // the rest of a checkpoint behind the fixed-size part read by
+    // readCheckpoint(): outputs and memory pages
     // -----------------
 
-    size_t step = 0;
-    int opcode = 0;
+    setupDecoding(c.imageSize);
+
+    lastOut_.resize(getField(in));
+    for (T & val: lastOut_) { val = T(getField(in)); }
+
+    size_t pageCount = getField(in);
+    size_t lastPage = (c.size + pagedMemory<T>::PAGE_SIZE-1) >>
+                      pagedMemory<T>::PAGE_BITS;
+    for (size_t i = 0; i < pageCount; i++) {
+        size_t num = getField(in);
+        if (num >= lastPage) {
+            throw std::runtime_error("intCode: corrupt checkpoint");
+        }
+
+        T * cells = code_.pageAt(num);
+        if (littleEndian()) {
+            in.read(reinterpret_cast<char *>(cells),
+                    pagedMemory<T>::PAGE_SIZE * sizeof(T));
+        } else {
+            unsigned char raw[pagedMemory<T>::PAGE_SIZE * sizeof(T)];
+            in.read(reinterpret_cast<char *>(raw), sizeof(raw));
+            for (size_t j = 0; j < pagedMemory<T>::PAGE_SIZE; j++) {
+                uint64_t val = 0;
+                for (size_t b = sizeof(T); b-- > 0; ) {
+                    val = (val << 8) | raw[j*sizeof(T) + b];
+                }
+                cells[j] = T(val);
+            }
+        }
+        if (!in) {
+            throw std::runtime_error("intCode: truncated checkpoint");
+        }
+    }
+
+    setStateHashing(c.flags & FLAG_HASHING);
+}
+
+
+template<typename T, typename D, typename P>
+typename intCode<T, D, P>::checkpoint
+intCode<T, D, P>::readCheckpoint(std::istream & in) {
+    char magic[4];
+    in.read(magic, 4);
+    if (!in || std::string(magic, 4) != "ICCK" ||
+        getField(in) != CHECKPOINT_VERSION || getField(in) != sizeof(T))
+    {
+        throw std::runtime_error("intCode: not a version 1 checkpoint of "
+                                 "this integer type");
+    }
+
+    checkpoint c;
+    c.flags = getField(in);
+    c.pos = getField(in);
+    c.relBase = T(getField(in));
+    c.inputCount = getField(in);
+    c.input = T(getField(in));
+    c.executed = getField(in);
+    c.imageSize = getField(in);
+    c.size = getField(in);
+
+    return c;
+}
+
+
+template<typename T, typename D, typename P>
+void intCode<T, D, P>::putField(std::ostream & out, uint64_t val) {
+    // 64-bit little-endian
+
+    for (int b = 0; b < 8; b++) {
+        out.put(char(val >> (8*b)));
+    }
+}
+
+
+template<typename T, typename D, typename P>
+uint64_t intCode<T, D, P>::getField(std::istream & in) {
+    unsigned char raw[8];
+    in.read(reinterpret_cast<char *>(raw), 8);
+    if (!in) {
+        throw std::runtime_error("intCode: truncated checkpoint");
+    }
+
+    uint64_t val = 0;
+    for (int b = 7; b >= 0; b--) {
+        val = (val << 8) | raw[b];
+    }
+
+    return val;
+}
+
+
+template<typename T, typename D, typename P>
+bool intCode<T, D, P>::run(const T * in, size_t nIn) {
+    // executes the int program on the nIn inputs in, see runIntCode().
+    // The instruction loop itself is chosen by the dispatch policy D
+    // -----------------
 
     if (stopAtInput_) {
         lastOut_.resize(0);
@@ -173,151 +852,368 @@ bool intCode<T>::runIntCode(const std::vector<T> & in) {
         inputCount_ = 0;
     }
 
+    profile_.resume();
+    return execute(in, nIn, D());
+}
 
-    while (opcode != HALT) {
-        getParameterMode();
-        opcode = paraMode_[0];
-
-        if (opcode == 1 || opcode == 2 || opcode == 7 || opcode == 8) {
-            step = 4;
-        } else if (opcode == 3 || opcode == 4 || opcode == 9) {
-            step = 2;
-        } else if (opcode == 5 || opcode == 6) {
-            step = 3;
-        }
-
-        // fill all remaining parameter modes with 0
-        paraMode_.resize(step);
 
-        if (opcode == ADD) {
-            modify1();
-        } else if (opcode == MULTIPLY) {
-            modify2();
-        } else if (opcode == INPUT) {
-            if (pos_ > 0 && stopAtInput_ && !stopped_) {
-                stopped_ = true;
-                return false;
-            }
+template<typename T, typename D, typename P>
+bool intCode<T, D, P>::execute(const T * in, size_t nIn, switchDispatch) {
+    // instruction loop dispatching through a switch on the opcode, see step()
+    // -----------------
 
-            inputCount_++;
-            if (inputCount_ <= in.size()) {
-                input_ = in[inputCount_-1];
-            } else {
-                std::cout << "Too few input arguments provided, type "
-                          << "Input here: ";
-                std::cin >> input_;
-            }
+    int res;
+    while ((res = step(in, nIn)) == RUNNING) {}
 
-            modify3();
-            stopped_ = false;
+    return res == HALTED;
+}
 
-            if (printInOut_) {
-                std::cout << "in: " << input_ << "\n";
-            }
-        } else if (opcode == OUTPUT) {
-            /* if stopAtOutput_ only resize lastOut_ if another output
-               instruction is issued. otherwise, it will be resized at last
-               call of runIntCode before HALT, erasing the last output.
-            */
 
-            if (stopAtOutput_) { lastOut_.resize(0); }
+template<typename T, typename D, typename P>
+inline int intCode<T, D, P>::step(const T * in, size_t nIn) {
+    // executes the single instruction at pos_. Returns RUNNING, STOPPED (stop
+    // at input/output or invalid opcode) or HALTED
+    // -----------------
 
-            modify4();
+    if (executed_ == limit_) { return STOPPED; }
 
-            if (printInOut_) {
-                std::cout << "out: " << lastOut_.back() << "\n";
-            }
+    instr_ = &fetch();
+    executed_++;
+    profile_.instruction(pos_, instr_->opcode);
 
-            if (stopAtOutput_) {
-                pos_ += step;
-                return false;
-            }
-        } else if (opcode == JUMPTRUE) {
+    switch (instr_->opcode) {
+        case ADD:
+            modify1();
+            pos_ += 4;
+            return RUNNING;
+        case MULTIPLY:
+            modify2();
+            pos_ += 4;
+            return RUNNING;
+        case INPUT:
+            if (!input(in, nIn)) { return STOPPED; }
+            pos_ += 2;
+            return RUNNING;
+        case OUTPUT:
+            return output() ? RUNNING : STOPPED;
+        case JUMPTRUE:
             modify5();
-        } else if (opcode == JUMPFALSE) {
+            return RUNNING;
+        case JUMPFALSE:
             modify6();
-        } else if (opcode == LESS) {
+            return RUNNING;
+        case LESS:
             modify7();
-        } else if (opcode == EQUAL) {
+            pos_ += 4;
+            return RUNNING;
+        case EQUAL:
             modify8();
-        } else if (opcode == ADJUSTBASE) {
+            pos_ += 4;
+            return RUNNING;
+        case ADJUSTBASE:
             modify9();
-        } else if (opcode > 9 && opcode != 99) {
-            std::cout << "ERROR: something went wrong - opcode = " << opcode;
-            std::cout << "(must be in (1, 2, ..., 8, 99))\n";
+            pos_ += 2;
+            return RUNNING;
+        case HALT:
+            return halt() ? HALTED : STOPPED;
+        default:
+            invalidOpcode();
+            return STOPPED;
+    }
+}
+
+
+template<typename T, typename D, typename P>
+bool intCode<T, D, P>::execute(const T * in, size_t nIn, threadedDispatch) {
+    // direct-threaded instruction loop: every instruction jumps straight to
+    // the handler of the next one (GCC/Clang labels as values). The handler
+    // index of an instruction is pre-decoded, see decode(). Falls back to the
+    // switch loop for compilers without labels as values
+    // -----------------
+
+#if defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+    static void * const handlers[] = {
+        &&op_invalid, &&op_add, &&op_multiply, &&op_input, &&op_output,
+        &&op_jumptrue, &&op_jumpfalse, &&op_less, &&op_equal,
+        &&op_adjustbase, &&op_halt
+    };
+
+#define INTCODE_NEXT() \
+    if (executed_ == limit_) { return false; } \
+    instr_ = &fetch(); \
+    executed_++; \
+    profile_.instruction(pos_, instr_->opcode); \
+    goto *handlers[instr_->handler]
+
+    INTCODE_NEXT();
+
+op_add:
+    modify1();
+    pos_ += 4;
+    INTCODE_NEXT();
+op_multiply:
+    modify2();
+    pos_ += 4;
+    INTCODE_NEXT();
+op_input:
+    if (!input(in, nIn)) { return false; }
+    pos_ += 2;
+    INTCODE_NEXT();
+op_output:
+    if (!output()) { return false; }
+    INTCODE_NEXT();
+op_jumptrue:
+    modify5();
+    INTCODE_NEXT();
+op_jumpfalse:
+    modify6();
+    INTCODE_NEXT();
+op_less:
+    modify7();
+    pos_ += 4;
+    INTCODE_NEXT();
+op_equal:
+    modify8();
+    pos_ += 4;
+    INTCODE_NEXT();
+op_adjustbase:
+    modify9();
+    pos_ += 2;
+    INTCODE_NEXT();
+op_halt:
+    return halt();
+op_invalid:
+    return invalidOpcode();
+
+#undef INTCODE_NEXT
+#pragma GCC diagnostic pop
+#else
+    return execute(in, nIn, switchDispatch());
+#endif
+}
+
+
+template<typename T, typename D, typename P>
+bool intCode<T, D, P>::input(const T * in, size_t nIn) {
+    // reads the next input and stores it. Returns false if execution has to
+    // stop in front of the input instruction (stopAtInput_, or an empty input
+    // channel)
+    // -----------------
+
+    if (inCh_) {
+        if (!inCh_->pop(input_)) {
+            executed_--; // counted by the instruction loop, not executed
+            profile_.wait(pos_, INPUT, true);
             return false;
         }
+    } else if (pos_ > 0 && stopAtInput_ && !stopped_) {
+        stopped_ = true;
+        executed_--;
+        profile_.wait(pos_, INPUT, true);
+        return false;
+    } else {
+        inputCount_++;
+        if (inputCount_ <= nIn) {
+            input_ = in[inputCount_-1];
+        } else {
+            std::cout << "Too few input arguments provided, type "
+                      << "Input here: ";
+            std::cin >> input_;
+        }
+    }
 
-        if (opcode != 5 && opcode != 6) { pos_ += step; }
-    } // WHILE pos_ < code_.size()
+    modify3();
+    stopped_ = false;
 
     if (printInOut_) {
-        std::cout << "99 - HALTED\n";
+        std::cout << "in: " << input_ << "\n";
     }
 
     return true;
 }
 
 
-template<typename T>
-bool intCode<T>::runIntCode(const T & in) {
-    // Allows for passing of single input as scalar, turns it into vector and
-    // passes it to intCode<T>::runIntCode(const std::vector<T> & in)
+template<typename T, typename D, typename P>
+bool intCode<T, D, P>::output() {
+    // writes the output and moves past the output instruction. Returns false
+    // if execution has to stop after the output (stopAtOutput_) or in front
+    // of it (full output channel)
+    // -----------------
+
+    if (outCh_) {
+        if (outCh_->full()) {
+            executed_--; // counted by the instruction loop, not executed
+            profile_.wait(pos_, OUTPUT, true);
+            return false;
+        }
+
+        modify4();
+        pos_ += 2;
 
-	std::vector<T> inVec;
-    inVec.push_back(in);
-    bool res = runIntCode(inVec);
+        if (printInOut_) {
+            std::cout << "out: " << outCh_->back() << "\n";
+        }
 
-	return res;
-}
+        return true;
+    }
 
+    /* if stopAtOutput_ only resize lastOut_ if another output
+       instruction is issued. otherwise, it will be resized at last
+       call of runIntCode before HALT, erasing the last output.
+    */
 
-template<typename T>
-bool intCode<T>::runIntCode() {
-    // Default argument for std::vector<T> input, in case no input vector is
-    // provided. Prompts a manual input via std::cin for any input instruction
+    if (stopAtOutput_) { lastOut_.resize(0); }
 
-	std::vector<T> emptyVec;
-    bool res = runIntCode(emptyVec);
+    modify4();
+    pos_ += 2;
 
-	return res;
+    if (printInOut_) {
+        std::cout << "out: " << lastOut_.back() << "\n";
+    }
+
+    if (stopAtOutput_) { profile_.wait(pos_-2, OUTPUT, false); }
+    return !stopAtOutput_;
 }
 
 
-// --- PRIVATE ---
+template<typename T, typename D, typename P>
+bool intCode<T, D, P>::halt() {
+    if (printInOut_) {
+        std::cout << "99 - HALTED\n";
+    }
+
+    return true;
+}
+
+
+template<typename T, typename D, typename P>
+bool intCode<T, D, P>::invalidOpcode() {
+    std::cout << "ERROR: something went wrong - opcode = " << instr_->opcode;
+    std::cout << "(must be in (1, 2, ..., 8, 99))\n";
+
+    return false;
+}
 
-template<typename T>
-void intCode<T>::getParameterMode() {
-    // from first integer in instruction (of form ABCDE):
+
+template<typename T, typename D, typename P>
+typename intCode<T, D, P>::instruction intCode<T, D, P>::decode(T word) {
+    // from integer of form ABCDE:
     // - last two digits (DE) give opcode
     // - other digits (ABC - read from right to left, so CBA) give parameter
     //   modes of parameters in instruction. Parameter mode can be 1 (immediate
-    //   mode, meaning the parameter is taken by value), or 0 (position mode,
-    //   meaning the parameter gives the position/index of the value)
-    //   If no parameter modes are provided, they are set to default - 0
+    //   mode, meaning the parameter is taken by value), 0 (position mode,
+    //   meaning the parameter gives the position/index of the value) or 2
+    //   (relative mode). If no parameter modes are provided, they are 0
+    // - step is the number of integers in the instruction set, 0 for
+    //   anything that is not a valid opcode (data cells are decoded as well)
+    // - handler is the opcode mapped to 0..10 (0 invalid, 10 halt)
     // -------------------------
 
-    paraMode_.resize(0);
+    instruction ins;
+    ins.opcode = int(word % 100);
+    ins.mode[0] = int(word / 100 % 10);
+    ins.mode[1] = int(word / 1000 % 10);
+    ins.mode[2] = int(word / 10000 % 10);
+
+    ins.handler = ins.opcode;
+    ins.word = word;
+    switch (ins.opcode) {
+        case ADD: case MULTIPLY: case LESS: case EQUAL:
+            ins.step = 4; break;
+        case JUMPTRUE: case JUMPFALSE:
+            ins.step = 3; break;
+        case INPUT: case OUTPUT: case ADJUSTBASE:
+            ins.step = 2; break;
+        case HALT:
+            ins.step = 1; ins.handler = 10; break;
+        default:
+            ins.step = 0; ins.handler = 0;
+    }
 
-    std::string xs = std::to_string(code_[pos_]);
-    if (xs.size() > 2) {
-        // opcode are LAST 2 digits of instruction
-        std::string ops = xs.substr(xs.size()-2);
-        paraMode_.push_back(std::stoi(ops));
+    return ins;
+}
 
-        for (int i = xs.size()-3; i >= 0; i--) {
-            paraMode_.push_back(xs[i]-'0');
+
+template<typename T, typename D, typename P>
+const typename intCode<T, D, P>::instruction &
+intCode<T, D, P>::predecode(T word) {
+    // fetch() for a chunk that is not decoded yet: decodes the chunk of pos_
+    // from memory, unless another copy is doing so right now (the
+    // instruction is then decoded on the fly). Records decoded from integers
+    // that were already overwritten are harmless, fetch() checks every
+    // record against memory
+
+    size_t chunk = pos_ / DECODE_CHUNK;
+    char expected = 0;
+    if (pos_ < decodedSize_ &&
+        ready_[chunk].compare_exchange_strong(expected, 1,
+                                              std::memory_order_acquire))
+    {
+        size_t start = chunk * DECODE_CHUNK;
+        size_t end = std::min(start + DECODE_CHUNK, decodedSize_);
+        for (size_t p = start; p < end; p++) {
+            decoded_->records[p] = decode(code_.read(p));
         }
+        ready_[chunk].store(2, std::memory_order_release);
+
+        if (records_[pos_].word == word) { return records_[pos_]; }
+    }
+
+    fetched_ = decode(word);
+    return fetched_;
+}
+
+
+template<typename T, typename D, typename P>
+const typename intCode<T, D, P>::instruction & intCode<T, D, P>::fetch() {
+    // pre-decoded instruction at pos_. Positions beyond the original program
+    // (memory appended at run time) and integers overwritten since
+    // construction (the record no longer matches memory) are decoded on the
+    // fly
+
+    T word = code_.read(pos_);
+
+    if (pos_ < decodedSize_ &&
+        ready_[pos_ / DECODE_CHUNK].load(std::memory_order_acquire) == 2)
+    {
+        const instruction & ins = records_[pos_];
+        if (ins.word == word) { return ins; }
     } else {
-        paraMode_.push_back(code_[pos_]);
+        return predecode(word);
+    }
+
+    fetched_ = decode(word);
+    return fetched_;
+}
+
+
+template<typename T, typename D, typename P>
+void intCode<T, D, P>::invalidate() {
+    // called after each write to target_ (see write()). Updates the state
+    // hash; pre-decoded records need no update (see fetch()), translated
+    // blocks containing the written integer (self-modifying code) are
+    // discarded
+
+    if (hashing_) {
+        memHash_ ^= cellHash(target_, old_) ^
+                    cellHash(target_, code_.read(target_));
+    }
+
+    if (std::is_same<D, compiledDispatch>::value && blocks_ &&
+        target_ < blocks_->compiled.size() && blocks_->compiled[target_])
+    {
+        discardBlocks(target_);
     }
 }
 
 
-template<typename T>
-void intCode<T>::setParameterMode(std::vector<T *> & params)
+template<typename T, typename D, typename P>
+template<size_t N>
+void intCode<T, D, P>::setParameterMode(T (&params)[N])
 {
-    // set pointers to integers depending on parameter mode
+    // reads the values of the first N parameters depending on parameter mode
     // - position mode (0)
     //   (parameter interpreted as position of value)
     // - immediate mode (1)
@@ -325,123 +1221,492 @@ void intCode<T>::setParameterMode(std::vector<T *> & params)
     // - relative mode (2)
     //   (parameter is interpreted as position, value is at
     //   position + relative base)
+    // addresses beyond the original program are served by the pages of
+    // code_, see pagedMemory.hpp. Reading never allocates or duplicates a
+    // page
+
+    assert(instr_->step >= N+1);
+
+    for (size_t i = 0; i < N; i++) {
+        T addr;
+        if (instr_->mode[i] == IMMEDIATE) {
+            addr = pos_+1+i;
+        } else if (instr_->mode[i] == RELATIVE) {
+            addr = code_.read(pos_+1+i) + relBase_;
+        } else {
+            addr = code_.read(pos_+1+i);
+        }
 
-    assert(paraMode_.size() == params.size()+1);
-    assert(pos_+1+params.size() > 0 ||
-           *(code_.begin() + pos_+1+params.size()) > 0 ||
-           *(code_.begin() + pos_+1+params.size()) + relBase_ > 0);
-
-    while (pos_+1+params.size() > code_.size() ||
-           unsigned(*(code_.begin() + pos_+1+params.size())) > code_.size() ||
-           unsigned(*(code_.begin() + pos_+1+params.size()) + relBase_) > code_.size())
-    {
-        code_.push_back(0);
+        assert(addr >= 0);
+        params[i] = code_.read(addr);
     }
+}
 
-    for (size_t i = 0; i < params.size(); i++) {
-        if (*(paraMode_.begin()+1+i) == POSITION) {
-            params[i] = &( *(code_.begin() + *(code_.begin() + pos_+1+i) ) );
-        } else if (*(paraMode_.begin()+1+i) == IMMEDIATE) {
-            params[i] = &( *(code_.begin() + pos_+1+i) );
-        } else if (*(paraMode_.begin()+1+i) == RELATIVE) {
-            params[i] = &( *(code_.begin() + *(code_.begin() + pos_+1+i)
-                                           + relBase_) );
-        }
+
+template<typename T, typename D, typename P>
+T * intCode<T, D, P>::target(size_t i)
+{
+    // resolves parameter i (the last one of the instruction) as the address
+    // written to, see write(). Immediate mode writes to the parameter itself
+
+    assert(instr_->step == i+2);
+
+    T addr;
+    if (instr_->mode[i] == IMMEDIATE) {
+        addr = pos_+1+i;
+    } else if (instr_->mode[i] == RELATIVE) {
+        addr = code_.read(pos_+1+i) + relBase_;
+    } else {
+        addr = code_.read(pos_+1+i);
     }
+
+    assert(addr >= 0);
+    return write(addr);
 }
 
 
-template<typename T>
-void intCode<T>::modify1()
+template<typename T, typename D, typename P>
+inline T * intCode<T, D, P>::write(size_t addr)
 {
-    std::vector<T *> params(3);
-    setParameterMode(params);
+    // integer at addr for writing, remembers addr in target_ and (state
+    // hashing) its value before the write for invalidate()
 
-    *params[2] = (*params[0]) + (*params[1]);
+    target_ = addr;
+    if (hashing_) { old_ = code_.read(addr); }
+
+    return code_.at(addr);
 }
 
 
-template<typename T>
-void intCode<T>::modify2()
+template<typename T, typename D, typename P>
+void intCode<T, D, P>::modify1()
 {
-    std::vector<T *> params(3);
+    T params[2];
     setParameterMode(params);
 
-    *params[2] = (*params[0]) * (*params[1]);
+    *target(2) = params[0] + params[1];
+    invalidate();
 }
 
 
-template<typename T>
-void intCode<T>::modify3()
+template<typename T, typename D, typename P>
+void intCode<T, D, P>::modify2()
 {
-    std::vector<T *> params(1);
+    T params[2];
     setParameterMode(params);
 
-    *params[0] = input_;
+    *target(2) = params[0] * params[1];
+    invalidate();
+}
+
+
+template<typename T, typename D, typename P>
+void intCode<T, D, P>::modify3()
+{
+    *target(0) = input_;
+    invalidate();
 }
 
 
-template<typename T>
-void intCode<T>::modify4()
+template<typename T, typename D, typename P>
+void intCode<T, D, P>::modify4()
 {
-    std::vector<T *> params(1);
+    T params[1];
     setParameterMode(params);
 
-    lastOut_.push_back(*params[0]);
+    if (outCh_) {
+        outCh_->push(params[0]);
+        return;
+    }
+
+    size_t capacity = lastOut_.capacity();
+    lastOut_.push_back(params[0]);
+    if (lastOut_.capacity() != capacity) { allocations_++; }
 }
 
 
-template<typename T>
-void intCode<T>::modify5()
+template<typename T, typename D, typename P>
+void intCode<T, D, P>::modify5()
 {
-    std::vector<T *> params(2);
+    T params[2];
     setParameterMode(params);
 
-    if (*params[0] != 0) { pos_ = *params[1]; }
+    if (params[0] != 0) { pos_ = params[1]; }
     else { pos_ += 3; }
 }
 
 
-template<typename T>
-void intCode<T>::modify6()
+template<typename T, typename D, typename P>
+void intCode<T, D, P>::modify6()
 {
-    std::vector<T *> params(2);
+    T params[2];
     setParameterMode(params);
 
-    if (*params[0] == 0) { pos_ = *params[1]; }
+    if (params[0] == 0) { pos_ = params[1]; }
     else { pos_ += 3; }
 }
 
 
-template<typename T>
-void intCode<T>::modify7()
+template<typename T, typename D, typename P>
+void intCode<T, D, P>::modify7()
 {
-    std::vector<T *> params(3);
+    T params[2];
     setParameterMode(params);
 
-    if (*params[0] < *params[1]) { *params[2] = 1; }
-    else { *params[2] = 0; }
+    *target(2) = params[0] < params[1] ? 1 : 0;
+    invalidate();
 }
 
 
-template<typename T>
-void intCode<T>::modify8()
+template<typename T, typename D, typename P>
+void intCode<T, D, P>::modify8()
 {
-    std::vector<T *> params(3);
+    T params[2];
     setParameterMode(params);
 
-    if (*params[0] == *params[1]) { *params[2] = 1; }
-    else { *params[2] = 0; }
+    *target(2) = params[0] == params[1] ? 1 : 0;
+    invalidate();
 }
 
 
-template<typename T>
-void intCode<T>::modify9()
+template<typename T, typename D, typename P>
+void intCode<T, D, P>::modify9()
 {
-    std::vector<T *> params(1);
+    T params[1];
     setParameterMode(params);
 
-    relBase_ += *params[0];
+    relBase_ += params[0];
+}
+
+
+template<typename T, typename D, typename P>
+uint64_t intCode<T, D, P>::hashMemory() const {
+    uint64_t h = 0;
+    code_.forEach([&](size_t addr, T val) { h ^= cellHash(addr, val); });
+
+    return h;
+}
+
+
+template<typename T, typename D, typename P>
+uint64_t intCode<T, D, P>::mix(uint64_t x) {
+    // finalizer of splitmix64, a bijection that spreads every input bit over
+    // the whole word
+
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111eb;
+    x ^= x >> 31;
+
+    return x;
+}
+
+
+// --- COMPILED BACKEND ---
+
+template<typename T, typename D, typename P>
+bool intCode<T, D, P>::execute(const T * in, size_t nIn, compiledDispatch) {
+    // runs translated blocks where possible, interprets single instructions
+    // (input, output, halt, code beyond the original program, instructions
+    // containing self-modified integers) everywhere else
+    // -----------------
+
+    if (!blocks_) {
+        blocks_ = std::make_shared<blockTable>();
+        blocks_->blocks.resize(decoded_->size);
+        blocks_->compiled.resize(decoded_->size, 0);
+        blocks_->modified.resize(decoded_->size, 0);
+        allocations_ += tableAllocations();
+    }
+
+    while (true) {
+        if (pos_ < blocks_->blocks.size()) {
+            retired_.reset();
+
+            const block * b = blocks_->blocks[pos_].get();
+            if (!b) { b = &compile(pos_); }
+
+            // a block that would run past limit_ is interpreted instead
+            if (b->count > 0 && limit_ - executed_ >= b->count) {
+                abort_ = false;
+                size_t at = pos_; // position of op, for the profiler
+                for (const microOp & op: b->ops) {
+                    if (P::enabled) {
+                        profile_.instruction(at, int(code_.read(at) % 100));
+                    }
+                    op.run(*this, op);
+                    executed_ += op.count;
+                    if (P::enabled) {
+                        if (op.count == 2 && !abort_) { // the jump
+                            profile_.instruction(at+4,
+                                                 int(code_.read(at+4) % 100));
+                            profile_.fused(at, 2);
+                        }
+                        at = op.next;
+                    }
+                    if (abort_) { break; }
+                }
+                continue;
+            }
+        }
+
+        int res = step(in, nIn);
+        if (res != RUNNING) { return res == HALTED; }
+    }
+}
+
+
+template<typename T, typename D, typename P>
+const typename intCode<T, D, P>::block & intCode<T, D, P>::compile(size_t start) {
+    // translates the basic block starting at start into micro-ops. An empty
+    // block means the instruction at start has to be interpreted. A table
+    // shared with a copy is duplicated first (the blocks themselves stay
+    // shared)
+    // -----------------
+
+    if (blocks_.use_count() > 1) {
+        blocks_ = std::make_shared<blockTable>(*blocks_);
+        allocations_ += tableAllocations();
+    }
+
+    block b;
+    b.count = 0;
+    size_t p = start;
+    size_t size = decoded_->size;
+
+    while (p < size) {
+        instruction ins = decode(code_.read(p));
+
+        if (ins.opcode == INPUT || ins.opcode == OUTPUT ||
+            ins.opcode == HALT || ins.step == 0 ||
+            p + ins.step > size)
+        {
+            break;
+        }
+
+        bool flagged = false;
+        for (size_t i = p; i < p + ins.step; i++) {
+            flagged = flagged || blocks_->modified[i];
+        }
+        if (flagged) { break; }
+
+        microOp op;
+        op.next = p + ins.step;
+        op.count = 1;
+        for (size_t i = 0; i+1 < ins.step; i++) {
+            op.arg[i] = code_.read(p+1+i);
+        }
+
+        // the written parameter (always the last one) in immediate mode
+        // writes to the parameter itself
+        if (ins.step == 4 && ins.mode[2] == IMMEDIATE) {
+            ins.mode[2] = POSITION;
+            op.arg[2] = p+3;
+        }
+
+        op.run = ins.opcode == ADD ?
+                     selectOp<ADD>(ins.mode[0], ins.mode[1], ins.mode[2]) :
+                 ins.opcode == MULTIPLY ?
+                     selectOp<MULTIPLY>(ins.mode[0], ins.mode[1], ins.mode[2]) :
+                 ins.opcode == LESS ?
+                     selectOp<LESS>(ins.mode[0], ins.mode[1], ins.mode[2]) :
+                 ins.opcode == EQUAL ?
+                     selectOp<EQUAL>(ins.mode[0], ins.mode[1], ins.mode[2]) :
+                 ins.opcode == JUMPTRUE ?
+                     selectOp<JUMPTRUE>(ins.mode[0], ins.mode[1], 0) :
+                 ins.opcode == JUMPFALSE ?
+                     selectOp<JUMPFALSE>(ins.mode[0], ins.mode[1], 0) :
+                     selectOp<ADJUSTBASE>(ins.mode[0], 0, 0);
+
+        for (size_t i = p; i < p + ins.step; i++) {
+            blocks_->compiled[i] = 1;
+        }
+
+        bool fused = fusion_ && fuse(p, ins, op);
+
+        size_t capacity = b.ops.capacity();
+        b.ops.push_back(op);
+        if (b.ops.capacity() != capacity) { allocations_++; }
+        b.count += op.count;
+        p = op.next;
+
+        if (fused || ins.opcode == JUMPTRUE || ins.opcode == JUMPFALSE) {
+            break;
+        }
+    }
+
+    blocks_->blocks[start] = std::make_shared<const block>(std::move(b));
+    allocations_++;
+    return *blocks_->blocks[start];
+}
+
+
+template<typename T, typename D, typename P>
+bool intCode<T, D, P>::fuse(size_t p, const instruction & ins, microOp & op) {
+    // turns op (translated from ins at p) into a superinstruction together
+    // with the jump behind it, see COMPILED BACKEND. Returns false and
+    // leaves op unchanged if the pair does not qualify
+
+    size_t q = p + ins.step;
+    if ((ins.opcode != ADD && ins.opcode != LESS && ins.opcode != EQUAL) ||
+        q + 3 > decoded_->size || blocks_->modified[q] ||
+        blocks_->modified[q+1] || blocks_->modified[q+2])
+    {
+        return false;
+    }
+
+    instruction jump = decode(code_.read(q));
+    T cond = code_.read(q+1);
+    bool tested = (jump.mode[0] == POSITION && ins.mode[2] != RELATIVE) ||
+                  (jump.mode[0] == RELATIVE && ins.mode[2] == RELATIVE);
+
+    // op.arg[2] is the address written (immediate mode was translated to
+    // position mode above)
+    if ((jump.opcode != JUMPTRUE && jump.opcode != JUMPFALSE) ||
+        jump.mode[1] != IMMEDIATE || !tested || cond != op.arg[2])
+    {
+        return false;
+    }
+
+    int m2 = ins.mode[2] == RELATIVE ? RELATIVE : POSITION;
+    int base = jump.opcode == JUMPTRUE ? FUSEDTRUE : FUSEDFALSE;
+    op.run = ins.opcode == ADD ?
+                 (base == FUSEDTRUE ?
+                     selectOp<FUSEDTRUE + ADD>(ins.mode[0], ins.mode[1], m2) :
+                     selectOp<FUSEDFALSE + ADD>(ins.mode[0], ins.mode[1], m2)) :
+             ins.opcode == LESS ?
+                 (base == FUSEDTRUE ?
+                     selectOp<FUSEDTRUE + LESS>(ins.mode[0], ins.mode[1], m2) :
+                     selectOp<FUSEDFALSE + LESS>(ins.mode[0], ins.mode[1], m2)) :
+                 (base == FUSEDTRUE ?
+                     selectOp<FUSEDTRUE + EQUAL>(ins.mode[0], ins.mode[1], m2) :
+                     selectOp<FUSEDFALSE + EQUAL>(ins.mode[0], ins.mode[1], m2));
+    op.arg[3] = code_.read(q+2);
+    op.next = q + 3;
+    op.count = 2;
+
+    for (size_t i = q; i < q + 3; i++) {
+        blocks_->compiled[i] = 1;
+    }
+
+    return true;
+}
+
+
+template<typename T, typename D, typename P>
+void intCode<T, D, P>::discardBlocks(size_t addr) {
+    // a translated integer at addr was written: replace the table by an
+    // empty one (the old one is kept alive in retired_ until the running
+    // block has returned, copies keep using it) and flag addr so that it is
+    // interpreted from now on
+
+    std::shared_ptr<blockTable> fresh = std::make_shared<blockTable>();
+    fresh->blocks.resize(blocks_->blocks.size());
+    fresh->compiled.resize(blocks_->compiled.size(), 0);
+    fresh->modified = blocks_->modified;
+    fresh->modified[addr] = 1;
+    allocations_ += tableAllocations();
+    abort_ = true;
+
+    retired_ = std::move(blocks_);
+    blocks_ = std::move(fresh);
+}
+
+
+template<typename T, typename D, typename P>
+template<int M>
+inline T intCode<T, D, P>::load(const microOp & op, int i) {
+    if (M == IMMEDIATE) {
+        return op.arg[i];
+    } else if (M == RELATIVE) {
+        return code_.read(op.arg[i] + relBase_);
+    }
+
+    return code_.read(op.arg[i]);
+}
+
+
+template<typename T, typename D, typename P>
+template<int M>
+inline void intCode<T, D, P>::store(const microOp & op, int i, T val) {
+    T addr = (M == RELATIVE) ? op.arg[i] + relBase_ : op.arg[i];
+    assert(addr >= 0);
+
+    *write(addr) = val;
+    invalidate();
+}
+
+
+template<typename T, typename D, typename P>
+template<int OP, int M0, int M1, int M2>
+void intCode<T, D, P>::runOp(intCode & vm, const microOp & op) {
+    // micro-op handler for opcode OP with parameter modes M0, M1, M2 (OP
+    // above HALT: superinstruction, FUSEDTRUE/FUSEDFALSE + opcode). pos_ is
+    // set before the store, which may discard the block op belongs to
+
+    if (OP == JUMPTRUE || OP == JUMPFALSE) {
+        bool jump = (vm.template load<M0>(op, 0) != 0) == (OP == JUMPTRUE);
+        vm.pos_ = jump ? size_t(vm.template load<M1>(op, 1)) : op.next;
+        return;
+    }
+
+    vm.pos_ = OP > HALT ? op.next - 3 : op.next; // a superinstruction stops
+                                                 // in front of the jump
+
+    if (OP == ADJUSTBASE) {
+        vm.relBase_ += vm.template load<M0>(op, 0);
+        return;
+    }
+
+    const int CODE = OP % 100;
+    T a = vm.template load<M0>(op, 0);
+    T b = vm.template load<M1>(op, 1);
+    T res = CODE == ADD ? a + b :
+            CODE == MULTIPLY ? a * b :
+            CODE == LESS ? T(a < b) : T(a == b);
+
+    vm.template store<M2>(op, 2, res);
+
+    if (OP > HALT) {
+        if (vm.abort_) { // the jump was discarded, it is interpreted
+            vm.executed_--;
+            return;
+        }
+        bool jump = (res != 0) == (OP < FUSEDFALSE);
+        vm.pos_ = jump ? size_t(op.arg[3]) : op.next;
+    }
+}
+
+
+template<typename T, typename D, typename P>
+template<int OP, int M0, int M1>
+typename intCode<T, D, P>::handler intCode<T, D, P>::selectOp3(int m2) {
+    if (m2 == RELATIVE) { return &runOp<OP, M0, M1, RELATIVE>; }
+    return &runOp<OP, M0, M1, POSITION>;
+}
+
+
+template<typename T, typename D, typename P>
+template<int OP, int M0>
+typename intCode<T, D, P>::handler intCode<T, D, P>::selectOp2(int m1, int m2) {
+    if (m1 == IMMEDIATE) { return selectOp3<OP, M0, IMMEDIATE>(m2); }
+    if (m1 == RELATIVE) { return selectOp3<OP, M0, RELATIVE>(m2); }
+    return selectOp3<OP, M0, POSITION>(m2);
+}
+
+
+template<typename T, typename D, typename P>
+template<int OP>
+typename intCode<T, D, P>::handler intCode<T, D, P>::selectOp(int m0, int m1,
+                                                         int m2)
+{
+    // handler specialized for the parameter modes m0, m1, m2 (unknown modes
+    // behave like position mode, as in setParameterMode())
+
+    if (m0 == IMMEDIATE) { return selectOp2<OP, IMMEDIATE>(m1, m2); }
+    if (m0 == RELATIVE) { return selectOp2<OP, RELATIVE>(m1, m2); }
+    return selectOp2<OP, POSITION>(m1, m2);
 }
 
 
@@ -0,0 +1,295 @@
+#ifndef INTCODEIMAGE_HPP
+#define INTCODEIMAGE_HPP
+
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <limits>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#define INTCODEIMAGE_MMAP 1
+#endif
+
+
+/*
+Binary Intcode image: the program as fixed-width little-endian integers
+behind a small header, so that loading it neither parses text nor copies the
+integers. intCodeToImage.cpp converts the comma separated input files.
+
+--- FORMAT (version 1) ---
+
+    offset  size  content
+         0     4  magic "ICIM"
+         4     1  version (1)
+         5     1  word width in bytes (4 or 8)
+         6     2  0
+         8     8  number of words n (little-endian)
+        16  n*w   the words, two's complement, little-endian
+
+The words start at offset 16, so they are aligned for any integer type once
+the file is mapped (mappings start at a page boundary).
+
+--- LOADING ---
+
+load() maps the file read-only (mmap, POSIX) if the words can be used as
+they are: the word width is sizeof(T) and the machine is little-endian. The
+image then points straight into the mapping, and an intCode constructed from
+it shares the mapped pages copy-on-write (see pagedMemory.hpp): a page of the
+file is copied into memory only when the program first writes to it, pages
+that are only read are never copied. Otherwise (other width, big-endian,
+no mmap) the words are read and converted into a vector owned by the image.
+
+The mapping stays alive as long as the image or any intCode built from it
+(or any copy of one) exists.
+
+--- CONSTRUCTOR ---
+
+# intCodeImage(const std::vector<T> & code)
+- image held in memory (copied), e.g. to save() it
+
+# static intCodeImage load(const std::string & path)
+- maps or reads the image file at path. Throws std::runtime_error if the
+  file cannot be opened, is not a version 1 image, is truncated or holds a
+  word that does not fit into T
+
+
+--- FUNCTIONS ---
+
+# const T * data() const, size_t size() const
+- the words and their number
+
+# bool isMapped() const
+- true IFF the words are read from the mapped file itself (zero-copy)
+
+# std::shared_ptr<const void> owner() const
+- keeps the storage of data() alive (shared by copies of the image)
+
+# static void save(const std::string & path, const std::vector<T> & code,
+                   int width = sizeof(T))
+- writes code as image file with words of width bytes (4 or 8). Throws
+  std::runtime_error if the file cannot be written or a word does not fit
+*/
+
+template<typename T>
+class intCodeImage {
+    public:
+        static_assert(std::is_same<int, T>::value ||
+                      std::is_same<long, T>::value ||
+                      std::is_same<long long, T>::value,
+                      "ERROR: class intCodeImage must be called with template\
+                       parameter of type <signed int>, i.e., int, long, etc.");
+
+        // Ctor
+        intCodeImage() = delete;
+        explicit intCodeImage(const std::vector<T> & code) :
+                storage_(std::make_shared<storage>())
+        {
+            storage_->words = code;
+            data_ = storage_->words.data();
+            size_ = code.size();
+        }
+
+        // Getters
+        const T * data() const { return data_; }
+        size_t size() const { return size_; }
+        bool isMapped() const { return storage_->map != nullptr; }
+        std::shared_ptr<const void> owner() const { return storage_; }
+
+        // Public Member
+        static intCodeImage load(const std::string &);
+        static void save(const std::string &, const std::vector<T> &,
+                         int width = sizeof(T));
+
+    private:
+        struct storage {
+            void * map; // mapped file (nullptr: words holds the image)
+            size_t length;
+            std::vector<T> words;
+
+            storage() : map(nullptr), length(0) {}
+            storage(const storage &) = delete;
+            storage & operator=(const storage &) = delete;
+            ~storage() {
+#ifdef INTCODEIMAGE_MMAP
+                if (map) { munmap(map, length); }
+#endif
+            }
+        };
+
+        std::shared_ptr<storage> storage_;
+        const T * data_;
+        size_t size_;
+
+        intCodeImage(std::shared_ptr<storage> s, const T * data, size_t n) :
+                storage_(std::move(s)), data_(data), size_(n)
+        {}
+
+        // Private Member
+        static uint64_t getWord(const unsigned char *, int);
+        static void putWord(unsigned char *, uint64_t, int);
+        static bool littleEndian() {
+            const uint16_t one = 1;
+            return *reinterpret_cast<const unsigned char *>(&one) == 1;
+        }
+        static T toValue(uint64_t, int);
+
+        // Static Constants
+        static const int VERSION = 1;
+        static const size_t HEADER = 16;
+};
+
+
+// ------------------------
+// --- MEMBER FUNCTIONS ---
+// ------------------------
+
+// --- PUBLIC ---
+
+template<typename T>
+intCodeImage<T> intCodeImage<T>::load(const std::string & path) {
+    // reads the header, then maps the words (zero-copy) or converts them
+    // -----------------
+
+    std::ifstream in(path, std::ios::binary);
+    unsigned char header[HEADER];
+    if (!in.is_open()) {
+        throw std::runtime_error("intCodeImage::load(): could not open " +
+                                 path);
+    }
+    in.read(reinterpret_cast<char *>(header), HEADER);
+    if (!in || std::memcmp(header, "ICIM", 4) != 0 ||
+        header[4] != VERSION || (header[5] != 4 && header[5] != 8))
+    {
+        throw std::runtime_error("intCodeImage::load(): " + path +
+                                 " is not a version 1 Intcode image");
+    }
+
+    int width = header[5];
+    uint64_t n = getWord(header + 8, 8);
+
+    in.seekg(0, std::ios::end);
+    uint64_t length = uint64_t(in.tellg());
+    if (n > (length - HEADER) / width) {
+        throw std::runtime_error("intCodeImage::load(): " + path +
+                                 " is truncated");
+    }
+
+    std::shared_ptr<storage> s = std::make_shared<storage>();
+
+#ifdef INTCODEIMAGE_MMAP
+    if (width == int(sizeof(T)) && littleEndian() && n > 0) {
+        int fd = open(path.c_str(), O_RDONLY);
+        void * map = fd < 0 ? MAP_FAILED :
+                     mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (fd >= 0) { close(fd); }
+
+        if (map != MAP_FAILED) {
+            s->map = map;
+            s->length = length;
+            const T * words = reinterpret_cast<const T *>(
+                                  static_cast<const char *>(map) + HEADER);
+            return intCodeImage(s, words, n);
+        }
+    }
+#endif
+
+    // converting load: any width, any byte order
+    std::vector<unsigned char> raw(n * width);
+    in.seekg(HEADER);
+    in.read(reinterpret_cast<char *>(raw.data()), raw.size());
+    if (!in) {
+        throw std::runtime_error("intCodeImage::load(): could not read " +
+                                 path);
+    }
+
+    s->words.resize(n);
+    for (size_t i = 0; i < n; i++) {
+        s->words[i] = toValue(getWord(&raw[i * width], width), width);
+    }
+
+    return intCodeImage(s, s->words.data(), n);
+}
+
+
+template<typename T>
+void intCodeImage<T>::save(const std::string & path,
+                           const std::vector<T> & code, int width)
+{
+    if (width != 4 && width != 8) {
+        throw std::runtime_error("intCodeImage::save(): width must be 4 or "
+                                 "8");
+    }
+
+    std::vector<unsigned char> buf(HEADER + code.size() * width, 0);
+    std::memcpy(buf.data(), "ICIM", 4);
+    buf[4] = VERSION;
+    buf[5] = width;
+    putWord(&buf[8], code.size(), 8);
+
+    for (size_t i = 0; i < code.size(); i++) {
+        if (width == 4 && (code[i] < INT32_MIN || code[i] > INT32_MAX)) {
+            throw std::runtime_error("intCodeImage::save(): " +
+                std::to_string(code[i]) + " does not fit into 4 bytes");
+        }
+        putWord(&buf[HEADER + i * width], uint64_t(int64_t(code[i])), width);
+    }
+
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char *>(buf.data()), buf.size());
+    if (!out) {
+        throw std::runtime_error("intCodeImage::save(): could not write " +
+                                 path);
+    }
+}
+
+
+// --- PRIVATE ---
+
+template<typename T>
+uint64_t intCodeImage<T>::getWord(const unsigned char * p, int width) {
+    uint64_t val = 0;
+    for (int i = width-1; i >= 0; i--) {
+        val = (val << 8) | p[i];
+    }
+
+    return val;
+}
+
+
+template<typename T>
+void intCodeImage<T>::putWord(unsigned char * p, uint64_t val, int width) {
+    for (int i = 0; i < width; i++) {
+        p[i] = (unsigned char)(val >> (8*i));
+    }
+}
+
+
+template<typename T>
+T intCodeImage<T>::toValue(uint64_t raw, int width) {
+    // sign-extends a word of width bytes and checks that it fits into T
+
+    int64_t val = width == 4 ? int64_t(int32_t(uint32_t(raw))) :
+                               int64_t(raw);
+
+    if (val < int64_t(std::numeric_limits<T>::min()) ||
+        val > int64_t(std::numeric_limits<T>::max()))
+    {
+        throw std::runtime_error("intCodeImage::load(): " +
+            std::to_string(val) + " does not fit into the integer type");
+    }
+
+    return T(val);
+}
+
+
+#endif // INTCODEIMAGE_HPP
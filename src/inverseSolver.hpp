@@ -0,0 +1,515 @@
+#ifndef INVERSESOLVER_HPP
+#define INVERSESOLVER_HPP
+
+
+#include <vector>
+#include <map>
+#include <utility>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <cstddef>
+
+#include "intCode.hpp"
+#include "channel.hpp"
+#include "specializer.hpp"
+
+
+/*
+Finds values of unknown memory cells (e.g. noun and verb of day 2) for which
+an Intcode program ends with a requested value in a cell or writes a
+requested output, without running the program for every combination.
+
+--- SYMBOLIC SOLVING ---
+
+The program is specialized to the unknown cells (see specializer.hpp). If
+the specialization is complete and the target is an expression of the
+unknowns only (no load, no unknown input), it is solved on that expression:
+- the polynomial degree of the expression in every unknown is tracked
+  (sums: maximum, products: sum, comparisons: not polynomial), so an unknown
+  the expression is affine in (degree 1, e.g. [1] * 360000 + [2] + 250635)
+  is solved for directly once all others are fixed: two evaluations and a
+  division instead of a loop over its domain
+- the domains of the other unknowns are bisected, every sub-box whose
+  interval bound of the expression (interval arithmetic over the expression,
+  comparisons included) does not contain the target is pruned
+For day 2 that takes a few dozen evaluations of the closed form instead of
+9,801 runs of the program.
+
+--- PRUNED SEARCH ---
+
+If the control flow depends on the unknowns (specialization incomplete) or
+the target is not a closed form, the first unknown is fixed to every value
+of its domain in turn and the program is specialized again to the remaining
+ones, which often removes the dependence: every subtree that becomes
+symbolic is solved as above. Once all unknowns are fixed, the program is
+run (with at most maxSteps instructions).
+
+Arithmetic follows T like the machine; interval bounds beyond 2^53 or the
+range of T in magnitude are treated as unbounded (never pruned).
+
+--- CONSTRUCTOR ---
+
+# inverseSolver(const std::vector<T> & image,
+                const std::vector<size_t> & unknownCells,
+                const std::vector<std::pair<T, T>> & domains,
+                const std::vector<T> & inputs = {},
+                size_t maxSteps = 1 << 24)
+- Arguments:
+    image - the program
+    unknownCells - addresses to solve for
+    domains - (lowest, highest) value of each unknown cell, inclusive
+    inputs - inputs of the program (the solver does not solve for inputs, a
+             program reading more inputs has no solution)
+    maxSteps - limit of instructions of every specialization and every run
+
+
+--- FUNCTIONS ---
+
+# std::vector<std::vector<T>> solveCell(size_t addr, T target,
+                                        size_t maxSolutions = 1)
+# std::vector<std::vector<T>> solveOutput(size_t i, T target,
+                                          size_t maxSolutions = 1)
+- Returns:
+    up to maxSolutions assignments (values in the order of unknownCells,
+    lexicographically increasing) for which the program halts with target
+    at address addr, or writes target as output i
+
+# bool isSymbolic() const
+- true IFF the last solve needed no pruned search, the program was a closed
+  form of all unknowns
+
+# size_t getSpecializationCount() const, size_t getBoxCount() const,
+  size_t getRunCount() const
+- work of the last solve: specializations, sub-boxes bounded, program runs
+*/
+
+template<typename T>
+class inverseSolver {
+    public:
+        // Ctor
+        inverseSolver() = delete;
+        inverseSolver(const std::vector<T> & image,
+                      const std::vector<size_t> & unknownCells,
+                      const std::vector<std::pair<T, T>> & domains,
+                      const std::vector<T> & inputs = {},
+                      size_t maxSteps = size_t(1) << 24) :
+                image_(image), cells_(unknownCells), domains_(domains),
+                inputs_(inputs), maxSteps_(maxSteps), symbolic_(false),
+                specializations_(0), boxes_(0), runs_(0)
+        {
+            for (size_t j = 0; j < cells_.size(); j++) {
+                index_[cells_[j]] = j;
+            }
+        }
+
+        // Getters
+        bool isSymbolic() const { return symbolic_; }
+        size_t getSpecializationCount() const { return specializations_; }
+        size_t getBoxCount() const { return boxes_; }
+        size_t getRunCount() const { return runs_; }
+
+        // Public Member
+        std::vector<std::vector<T>> solveCell(size_t addr, T target,
+                                              size_t maxSolutions = 1) {
+            return solve(goal{false, addr, target, maxSolutions});
+        }
+        std::vector<std::vector<T>> solveOutput(size_t i, T target,
+                                                size_t maxSolutions = 1) {
+            return solve(goal{true, i, target, maxSolutions});
+        }
+
+    private:
+        struct goal {
+            bool output; // target is output index, otherwise cell index
+            size_t index;
+            T target;
+            size_t maxSolutions;
+        };
+
+        struct interval {
+            long double lo;
+            long double hi;
+        };
+
+        // the target expression of one specialization
+        struct closedForm {
+            const specializer<T> * spec;
+            std::vector<size_t> cone; // nodes it depends on, operands first
+            std::vector<std::vector<int>> degree; // by cone position, unknown
+        };
+
+        std::vector<T> image_;
+        std::vector<size_t> cells_;
+        std::vector<std::pair<T, T>> domains_;
+        std::vector<T> inputs_;
+        size_t maxSteps_;
+        std::map<size_t, size_t> index_; // address -> index of unknown
+        bool symbolic_;
+        size_t specializations_;
+        size_t boxes_;
+        size_t runs_;
+        std::vector<std::vector<T>> solutions_;
+
+        // Private Member
+        std::vector<std::vector<T>> solve(const goal &);
+        void search(const goal &, std::vector<T> &);
+        bool analyse(const specializer<T> &, const goal &, closedForm &) const;
+        void bisect(const goal &, const closedForm &,
+                    std::vector<std::pair<T, T>> &, size_t);
+        void solveAffine(const goal &, const closedForm &,
+                         std::vector<std::pair<T, T>> &, size_t, size_t);
+        interval bound(const closedForm &,
+                       const std::vector<std::pair<T, T>> &) const;
+        T value(const goal &, const closedForm &,
+                const std::vector<std::pair<T, T>> &, size_t) const;
+        bool run(const goal &, const std::vector<T> &);
+        bool full(const goal & g) const {
+            return solutions_.size() >= g.maxSolutions;
+        }
+        static interval clamp(long double, long double);
+
+        // Static Constants
+        static const int NOT_POLYNOMIAL = 1 << 20; // degree
+};
+
+
+// ------------------------
+// --- MEMBER FUNCTIONS ---
+// ------------------------
+
+// --- PRIVATE ---
+
+template<typename T>
+std::vector<std::vector<T>> inverseSolver<T>::solve(const goal & g) {
+    symbolic_ = true;
+    specializations_ = 0;
+    boxes_ = 0;
+    runs_ = 0;
+    solutions_.clear();
+
+    std::vector<T> fixed;
+    search(g, fixed);
+
+    return solutions_;
+}
+
+
+template<typename T>
+void inverseSolver<T>::search(const goal & g, std::vector<T> & fixed) {
+    // the first fixed.size() unknowns hold fixed, see PRUNED SEARCH
+    // -----------------
+
+    if (full(g)) { return; }
+
+    std::vector<T> code(image_);
+    for (size_t j = 0; j < fixed.size(); j++) {
+        if (cells_[j] >= code.size()) { code.resize(cells_[j]+1, 0); }
+        code[cells_[j]] = fixed[j];
+    }
+
+    size_t j = fixed.size();
+    if (j == cells_.size()) {
+        if (run(g, code)) { solutions_.push_back(fixed); }
+        return;
+    }
+
+    std::vector<size_t> rest(cells_.begin() + j, cells_.end());
+    specializer<T> spec(code, rest, inputs_, maxSteps_);
+    specializations_++;
+
+    closedForm form;
+    if (analyse(spec, g, form)) {
+        std::vector<std::pair<T, T>> box(domains_);
+        for (size_t k = 0; k < j; k++) { box[k] = {fixed[k], fixed[k]}; }
+        bisect(g, form, box, j);
+        return;
+    }
+
+    symbolic_ = false;
+    for (T val = domains_[j].first; val <= domains_[j].second; val++) {
+        fixed.push_back(val);
+        search(g, fixed);
+        fixed.pop_back();
+        if (full(g) || val == domains_[j].second) { break; }
+    }
+}
+
+
+template<typename T>
+bool inverseSolver<T>::analyse(const specializer<T> & spec, const goal & g,
+                               closedForm & form) const
+{
+    // cone of the target and its degree in every unknown, false if it is
+    // no closed form of the unknowns
+
+    if (!spec.isComplete()) { return false; }
+    if (g.output && g.index >= spec.getOutputCount()) { return false; }
+
+    const auto & nodes = spec.getExpressions();
+    size_t root = g.output ? spec.getOutputNode(g.index) :
+                             spec.getValueNode(g.index);
+
+    std::vector<char> used(root+1, 0);
+    std::vector<size_t> todo{root};
+    while (!todo.empty()) {
+        size_t n = todo.back();
+        todo.pop_back();
+        if (used[n]) { continue; }
+        used[n] = 1;
+
+        int op = nodes[n].op;
+        if (op == specializer<T>::LOAD || op == specializer<T>::INPUT) {
+            return false;
+        }
+        if (op >= specializer<T>::ADD) {
+            todo.push_back(nodes[n].a);
+            todo.push_back(nodes[n].b);
+        }
+    }
+
+    form.spec = &spec;
+    form.cone.clear();
+    for (size_t n = 0; n <= root; n++) {
+        if (used[n]) { form.cone.push_back(n); }
+    }
+
+    // degrees, by position in the cone (operands come first)
+    std::vector<size_t> pos(root+1, 0);
+    form.degree.assign(form.cone.size(), std::vector<int>(cells_.size(), 0));
+    for (size_t p = 0; p < form.cone.size(); p++) {
+        const auto & e = nodes[form.cone[p]];
+        pos[form.cone[p]] = p;
+        std::vector<int> & d = form.degree[p];
+
+        if (e.op == specializer<T>::CELL) {
+            d[index_.at(size_t(e.val))] = 1;
+        } else if (e.op >= specializer<T>::ADD) {
+            const std::vector<int> & a = form.degree[pos[e.a]];
+            const std::vector<int> & b = form.degree[pos[e.b]];
+            for (size_t k = 0; k < d.size(); k++) {
+                if (e.op == specializer<T>::ADD) {
+                    d[k] = std::max(a[k], b[k]);
+                } else if (e.op == specializer<T>::MULTIPLY) {
+                    d[k] = std::min(a[k] + b[k], int(NOT_POLYNOMIAL));
+                } else {
+                    d[k] = a[k] || b[k] ? int(NOT_POLYNOMIAL) : 0;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+
+template<typename T>
+void inverseSolver<T>::bisect(const goal & g, const closedForm & form,
+                              std::vector<std::pair<T, T>> & box,
+                              size_t first)
+{
+    // solutions in box (unknowns below first are fixed), see SYMBOLIC
+    // SOLVING
+    // -----------------
+
+    if (full(g)) { return; }
+    boxes_++;
+
+    interval b = bound(form, box);
+    long double target = (long double)(g.target);
+    if (target < b.lo || target > b.hi) { return; }
+
+    // open unknowns, the widest affine one is solved for last
+    const std::vector<int> & degree = form.degree.back();
+    size_t open = 0;
+    size_t affine = box.size();
+    size_t split = box.size();
+    for (size_t k = first; k < box.size(); k++) {
+        if (box[k].first == box[k].second) { continue; }
+        open++;
+        T width = box[k].second - box[k].first;
+        if (degree[k] <= 1 &&
+            (affine == box.size() ||
+             width >= box[affine].second - box[affine].first))
+        {
+            affine = k;
+        }
+    }
+    for (size_t k = first; k < box.size(); k++) {
+        if (box[k].first == box[k].second || k == affine) { continue; }
+        if (split == box.size() || box[k].second - box[k].first >
+                                   box[split].second - box[split].first)
+        {
+            split = k;
+        }
+    }
+
+    if (open == 0) {
+        if (value(g, form, box, first) == g.target) {
+            std::vector<T> res;
+            for (const auto & d: box) { res.push_back(d.first); }
+            solutions_.push_back(res);
+        }
+        return;
+    }
+    if (open == 1 && affine != box.size()) {
+        solveAffine(g, form, box, first, affine);
+        return;
+    }
+    if (split == box.size()) { split = affine; } // only the affine one left
+
+    std::pair<T, T> whole = box[split];
+    T mid = whole.first + (whole.second - whole.first) / 2;
+    box[split] = {whole.first, mid};
+    bisect(g, form, box, first);
+    box[split] = {mid + 1, whole.second};
+    bisect(g, form, box, first);
+    box[split] = whole;
+}
+
+
+template<typename T>
+void inverseSolver<T>::solveAffine(const goal & g, const closedForm & form,
+                                   std::vector<std::pair<T, T>> & box,
+                                   size_t first, size_t k)
+{
+    // unknown k is the only open one and the target is a * x + c in it:
+    // a and c from two evaluations, then x = (target - c) / a
+
+    std::pair<T, T> whole = box[k];
+    box[k] = {whole.first, whole.first};
+    T f0 = value(g, form, box, first);
+    box[k] = {whole.first + 1, whole.first + 1};
+    T a = value(g, form, box, first) - f0;
+
+    std::vector<T> res;
+    for (const auto & d: box) { res.push_back(d.first); }
+
+    if (a == 0) {
+        // every value is a solution or none is
+        for (T x = whole.first; f0 == g.target && !full(g); x++) {
+            res[k] = x;
+            solutions_.push_back(res);
+            if (x == whole.second) { break; }
+        }
+    } else if ((g.target - f0) % a == 0) {
+        T steps = (g.target - f0) / a;
+        if (steps >= 0 && steps <= whole.second - whole.first) {
+            res[k] = whole.first + steps;
+            solutions_.push_back(res);
+        }
+    }
+
+    box[k] = whole;
+}
+
+
+template<typename T>
+typename inverseSolver<T>::interval inverseSolver<T>::bound(
+        const closedForm & form,
+        const std::vector<std::pair<T, T>> & box) const
+{
+    // interval of the target over box, operands before the nodes using them
+
+    const auto & nodes = form.spec->getExpressions();
+    std::vector<interval> val(form.cone.size());
+    std::vector<size_t> pos(form.cone.back()+1, 0);
+
+    for (size_t p = 0; p < form.cone.size(); p++) {
+        const auto & e = nodes[form.cone[p]];
+        pos[form.cone[p]] = p;
+
+        if (e.op == specializer<T>::CONSTANT) {
+            val[p] = clamp(e.val, e.val);
+        } else if (e.op == specializer<T>::CELL) {
+            const auto & d = box[index_.at(size_t(e.val))];
+            val[p] = clamp(d.first, d.second);
+        } else {
+            interval a = val[pos[e.a]];
+            interval b = val[pos[e.b]];
+            if (e.op == specializer<T>::ADD) {
+                val[p] = clamp(a.lo + b.lo, a.hi + b.hi);
+            } else if (e.op == specializer<T>::MULTIPLY) {
+                long double c[4] = {a.lo * b.lo, a.lo * b.hi, a.hi * b.lo,
+                                    a.hi * b.hi};
+                bool nan = false;
+                for (long double x: c) { nan = nan || std::isnan(x); }
+                val[p] = nan ? clamp(-INFINITY, INFINITY) :
+                               clamp(*std::min_element(c, c+4),
+                                     *std::max_element(c, c+4));
+            } else if (e.op == specializer<T>::LESS) {
+                val[p] = a.hi < b.lo ? interval{1, 1} :
+                         a.lo >= b.hi ? interval{0, 0} : interval{0, 1};
+            } else {
+                bool same = a.lo == a.hi && b.lo == b.hi && a.lo == b.lo &&
+                            std::isfinite(a.lo);
+                val[p] = same ? interval{1, 1} :
+                         a.hi < b.lo || b.hi < a.lo ? interval{0, 0} :
+                         interval{0, 1};
+            }
+        }
+    }
+
+    return val.back();
+}
+
+
+template<typename T>
+T inverseSolver<T>::value(const goal & g, const closedForm & form,
+                          const std::vector<std::pair<T, T>> & box,
+                          size_t first) const
+{
+    // exact value of the target at the point box (all unknowns fixed)
+
+    std::vector<T> cells;
+    for (size_t k = first; k < box.size(); k++) {
+        cells.push_back(box[k].first);
+    }
+
+    return g.output ? form.spec->evaluateOutput(g.index, cells) :
+                      form.spec->evaluate(g.index, cells);
+}
+
+
+template<typename T>
+bool inverseSolver<T>::run(const goal & g, const std::vector<T> & code) {
+    // runs code with every unknown fixed, true IFF it meets the goal
+
+    runs_++;
+    intCode<T> vm(code);
+    vm.setInstructionLimit(maxSteps_);
+
+    channel<T> in(std::max<size_t>(1, inputs_.size()));
+    channel<T> out;
+    for (const T & val: inputs_) { in.push(val); }
+
+    std::vector<T> output;
+    bool halted = false;
+    while (true) {
+        halted = vm.runIntCode(in, out);
+        size_t n = out.drain([&](const T & val) { output.push_back(val); });
+        if (halted || n == 0) { break; } // halted, waits or out of steps
+    }
+
+    if (g.output) {
+        return g.index < output.size() && output[g.index] == g.target;
+    }
+    return halted && vm.getMemory(g.index) == g.target;
+}
+
+
+template<typename T>
+typename inverseSolver<T>::interval inverseSolver<T>::clamp(long double lo,
+                                                            long double hi)
+{
+    // bounds beyond 2^53 are not exact any more, beyond T the machine
+    // overflows: unbounded
+
+    const long double limit = std::min(9007199254740992.0L,
+                                       (long double)(
+                                           std::numeric_limits<T>::max()));
+    return interval{lo < -limit ? -INFINITY : lo, hi > limit ? INFINITY : hi};
+}
+
+
+#endif // INVERSESOLVER_HPP
@@ -0,0 +1,407 @@
+#ifndef LOCKSTEP_HPP
+#define LOCKSTEP_HPP
+
+
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+
+
+/*
+Executes K copies (lanes) of the same Intcode program with different data in
+lockstep on one core, e.g. K noun/verb pairs of day 2. The state of all lanes
+is kept as structure of arrays: the memory is interleaved (address-major, the
+K values of one address are adjacent), program counters, relative bases and
+states are arrays of K. The per-lane loops of each operation are branch-free
+over the lanes so the compiler turns them into vector instructions (AVX2 or
+wider with -O3 -march=native, plain SSE2 otherwise).
+
+In every step the lanes at the lowest program counter whose instruction word
+is identical form the active group (a mask); the instruction is executed for
+the whole group at once, all other lanes are masked out. Lanes that diverge
+(different branches, self-modified code) therefore simply run in separate
+groups and usually join again at a common position. Every lane gives exactly
+the result of running intCode on it alone.
+
+The memory is dense (MAX_MEMORY integers over all lanes at most), a lane
+using a negative address or writing beyond MAX_MEMORY / K is retired with an
+error (isFailed()) instead of growing the memory of all lanes up to that
+address; run such a lane on intCode, whose memory is paged.
+
+--- TEMPLATE PARAMETERS ---
+
+# lockstep<T, K = 8>
+    T - signed integer type of the int code (int, long, long long)
+    K - number of lanes
+
+
+--- CONSTRUCTOR ---
+
+# lockstep(const std::vector<T> & image)
+- every lane starts at position 0 with the int code image
+
+
+--- FUNCTIONS ---
+
+# void patch(size_t lane, size_t addr, T val)
+- writes val to memory address addr of lane
+
+# void setInput(size_t lane, const std::vector<T> & in)
+- values read by the input instructions of lane (in order). A lane waiting
+  for input continues when run() is called again
+
+# void run()
+- runs all lanes until each of them has halted, waits for an input it was not
+  given or hit an invalid opcode
+
+# T getMemory(size_t lane, size_t addr) const,
+  const std::vector<T> & getOutput(size_t lane) const,
+  bool isHalted(size_t lane) const, bool isFailed(size_t lane) const
+- memory, outputs, halt state of lane and whether it was retired (invalid
+  opcode or an address out of range, see above)
+
+# size_t getStepCount() const, size_t getInstructionCount() const
+- number of group steps and of instructions executed over all lanes, the
+  ratio is the average number of lanes doing useful work per step
+*/
+
+template<typename T, size_t K = 8>
+class lockstep {
+    public:
+        static_assert(std::is_same<int, T>::value ||
+                      std::is_same<long, T>::value ||
+                      std::is_same<long long, T>::value,
+                      "ERROR: class lockstep must be called with template\
+                       parameter of type <signed int>, i.e., int, long, etc.");
+
+        // Ctor
+        lockstep() = delete;
+        explicit lockstep(const std::vector<T> & image);
+
+        // Getters
+        T getMemory(size_t lane, size_t addr) const {
+            return addr < size_ ? mem_[addr*K + lane] : 0;
+        }
+        const std::vector<T> & getOutput(size_t lane) const {
+            return out_[lane];
+        }
+        bool isHalted(size_t lane) const { return state_[lane] == HALTED; }
+        bool isFailed(size_t lane) const { return state_[lane] == FAILED; }
+        size_t getStepCount() const { return steps_; }
+        size_t getInstructionCount() const { return executed_; }
+
+        // Public Member
+        void patch(size_t, size_t, T);
+        void setInput(size_t, const std::vector<T> &);
+        void run();
+
+    private:
+        std::vector<T> mem_; // mem_[addr*K + lane]
+        size_t size_; // addresses per lane
+        size_t pc_[K];
+        T relBase_[K];
+        int state_[K];
+        std::vector<T> in_[K];
+        size_t inPos_[K];
+        std::vector<T> out_[K];
+        size_t steps_;
+        size_t executed_;
+
+        // Private Member
+        void grow(size_t);
+        void execute(size_t, T, bool (&)[K]);
+        void address(size_t, int, int, bool (&)[K], T (&)[K]);
+        void load(const T (&)[K], T (&)[K]) const;
+        void store(const T (&)[K], const T (&)[K], bool (&)[K]);
+        void retire(size_t l, bool (&mask)[K]) {
+            state_[l] = FAILED;
+            mask[l] = false;
+        }
+
+        // Static Constants
+        static const int ADD = 1;
+        static const int MULTIPLY = 2;
+        static const int INPUT = 3;
+        static const int OUTPUT = 4;
+        static const int JUMPTRUE = 5;
+        static const int JUMPFALSE = 6;
+        static const int LESS = 7;
+        static const int EQUAL = 8;
+        static const int ADJUSTBASE = 9;
+        static const int HALT = 99;
+
+        static const int RUNNING = 0; // lane states
+        static const int WAITING = 1;
+        static const int HALTED = 2;
+        static const int FAILED = 3;
+
+        static const int POSITION = 0;
+        static const int IMMEDIATE = 1;
+        static const int RELATIVE = 2;
+
+        static const size_t MAX_MEMORY = size_t(1) << 22; // all lanes
+        static const size_t MAX_ADDRESS = MAX_MEMORY / K; // per lane
+};
+
+
+// ------------------------
+// --- MEMBER FUNCTIONS ---
+// ------------------------
+
+// --- PUBLIC ---
+
+template<typename T, size_t K>
+lockstep<T, K>::lockstep(const std::vector<T> & image) :
+        size_(image.size()), steps_(0), executed_(0)
+{
+    mem_.resize(size_ * K);
+    for (size_t addr = 0; addr < size_; addr++) {
+        std::fill(mem_.begin() + addr*K, mem_.begin() + (addr+1)*K,
+                  image[addr]);
+    }
+
+    for (size_t l = 0; l < K; l++) {
+        pc_[l] = 0;
+        relBase_[l] = 0;
+        state_[l] = RUNNING;
+        inPos_[l] = 0;
+    }
+}
+
+
+template<typename T, size_t K>
+void lockstep<T, K>::patch(size_t lane, size_t addr, T val) {
+    if (addr >= MAX_ADDRESS) {
+        state_[lane] = FAILED;
+        return;
+    }
+    grow(addr);
+    mem_[addr*K + lane] = val;
+}
+
+
+template<typename T, size_t K>
+void lockstep<T, K>::setInput(size_t lane, const std::vector<T> & in) {
+    in_[lane] = in;
+    inPos_[lane] = 0;
+    if (state_[lane] == WAITING) { state_[lane] = RUNNING; }
+}
+
+
+template<typename T, size_t K>
+void lockstep<T, K>::run() {
+    // picks the lowest program counter of all running lanes and executes the
+    // instruction there for every lane at that position with the same
+    // instruction word
+    // -----------------
+
+    while (true) {
+        size_t pc = size_t(-1);
+        size_t lead = 0;
+        for (size_t l = 0; l < K; l++) {
+            if (state_[l] == RUNNING && pc_[l] < pc) {
+                pc = pc_[l];
+                lead = l;
+            }
+        }
+        if (pc == size_t(-1)) { break; }
+
+        grow(pc+3); // the longest instruction is read in one piece
+        T word = mem_[pc*K + lead];
+
+        bool mask[K];
+        for (size_t l = 0; l < K; l++) {
+            mask[l] = state_[l] == RUNNING && pc_[l] == pc &&
+                      mem_[pc*K + l] == word;
+        }
+
+        execute(pc, word, mask);
+        steps_++;
+    }
+}
+
+
+// --- PRIVATE ---
+
+template<typename T, size_t K>
+void lockstep<T, K>::grow(size_t addr) {
+    // makes addr addressable in every lane (zero-initialized)
+
+    if (addr < size_) { return; }
+
+    size_ = std::max(addr+1, 2*size_);
+    mem_.resize(size_ * K, 0);
+}
+
+
+template<typename T, size_t K>
+void lockstep<T, K>::execute(size_t pc, T word, bool (&mask)[K]) {
+    // executes the instruction word at pc for the lanes in mask, see
+    // intCode::decode() for the layout of word. Lanes retired on the way
+    // are removed from mask
+    // -----------------
+
+    int opcode = int(word % 100);
+    int mode[3] = {int(word / 100 % 10), int(word / 1000 % 10),
+                   int(word / 10000 % 10)};
+
+    T a[K], b[K], c[K], res[K];
+
+    switch (opcode) {
+        case ADD: case MULTIPLY: case LESS: case EQUAL:
+            address(pc, 0, mode[0], mask, a);
+            address(pc, 1, mode[1], mask, b);
+            address(pc, 2, mode[2], mask, c);
+            load(a, a);
+            load(b, b);
+            for (size_t l = 0; l < K; l++) {
+                res[l] = opcode == ADD ? a[l] + b[l] :
+                         opcode == MULTIPLY ? a[l] * b[l] :
+                         opcode == LESS ? T(a[l] < b[l]) : T(a[l] == b[l]);
+            }
+            store(c, res, mask);
+            for (size_t l = 0; l < K; l++) {
+                pc_[l] = mask[l] ? pc+4 : pc_[l];
+            }
+            break;
+        case JUMPTRUE: case JUMPFALSE:
+            address(pc, 0, mode[0], mask, a);
+            address(pc, 1, mode[1], mask, b);
+            load(a, a);
+            load(b, b);
+            for (size_t l = 0; l < K; l++) {
+                bool jump = (a[l] != 0) == (opcode == JUMPTRUE);
+                if (mask[l] && jump &&
+                    (b[l] < 0 || size_t(b[l]) >= MAX_ADDRESS))
+                {
+                    retire(l, mask);
+                }
+                pc_[l] = !mask[l] ? pc_[l] : jump ? size_t(b[l]) : pc+3;
+            }
+            break;
+        case ADJUSTBASE:
+            address(pc, 0, mode[0], mask, a);
+            load(a, a);
+            for (size_t l = 0; l < K; l++) {
+                relBase_[l] += mask[l] ? a[l] : 0;
+                pc_[l] = mask[l] ? pc+2 : pc_[l];
+            }
+            break;
+        case INPUT:
+            address(pc, 0, mode[0], mask, a);
+            for (size_t l = 0; l < K; l++) {
+                if (!mask[l]) { continue; }
+                if (inPos_[l] == in_[l].size()) {
+                    state_[l] = WAITING;
+                    executed_--; // counted below, not executed
+                    continue;
+                }
+                if (size_t(a[l]) >= MAX_ADDRESS) {
+                    retire(l, mask);
+                    continue;
+                }
+                grow(a[l]);
+                mem_[a[l]*K + l] = in_[l][inPos_[l]++];
+                pc_[l] = pc+2;
+            }
+            break;
+        case OUTPUT:
+            address(pc, 0, mode[0], mask, a);
+            load(a, a);
+            for (size_t l = 0; l < K; l++) {
+                if (!mask[l]) { continue; }
+                out_[l].push_back(a[l]);
+                pc_[l] = pc+2;
+            }
+            break;
+        case HALT:
+            for (size_t l = 0; l < K; l++) {
+                state_[l] = mask[l] ? HALTED : state_[l];
+            }
+            break;
+        default:
+            for (size_t l = 0; l < K; l++) {
+                state_[l] = mask[l] ? FAILED : state_[l];
+            }
+    }
+
+    for (size_t l = 0; l < K; l++) {
+        executed_ += mask[l];
+    }
+}
+
+
+template<typename T, size_t K>
+void lockstep<T, K>::address(size_t pc, int i, int mode, bool (&mask)[K],
+                             T (&addr)[K])
+{
+    // addresses of parameter i of the instruction at pc in all lanes, 0 for
+    // masked-out lanes (the mode is the same in the whole group). Lanes
+    // with a negative address are retired
+
+    const T * raw = &mem_[(pc+1+i)*K];
+
+    if (mode == IMMEDIATE) {
+        for (size_t l = 0; l < K; l++) {
+            addr[l] = mask[l] ? T(pc+1+i) : 0;
+        }
+        return;
+    }
+
+    T base[K];
+    bool negative = false;
+    for (size_t l = 0; l < K; l++) {
+        base[l] = mode == RELATIVE ? relBase_[l] : 0;
+        addr[l] = mask[l] ? raw[l] + base[l] : 0;
+        negative = negative || addr[l] < 0;
+    }
+
+    if (negative) {
+        for (size_t l = 0; l < K; l++) {
+            if (addr[l] < 0) {
+                retire(l, mask);
+                addr[l] = 0;
+            }
+        }
+    }
+}
+
+
+template<typename T, size_t K>
+void lockstep<T, K>::load(const T (&addr)[K], T (&val)[K]) const {
+    // gathers the values at addr (0 beyond the memory of the lanes)
+
+    for (size_t l = 0; l < K; l++) {
+        size_t a = size_t(addr[l]);
+        val[l] = a < size_ ? mem_[a*K + l] : 0;
+    }
+}
+
+
+template<typename T, size_t K>
+void lockstep<T, K>::store(const T (&addr)[K], const T (&val)[K],
+                           bool (&mask)[K])
+{
+    // scatters val to addr for the lanes in mask, lanes writing beyond
+    // MAX_ADDRESS are retired
+
+    T most = 0;
+    for (size_t l = 0; l < K; l++) {
+        most = std::max(most, addr[l]);
+    }
+    if (size_t(most) >= MAX_ADDRESS) {
+        most = 0;
+        for (size_t l = 0; l < K; l++) {
+            if (size_t(addr[l]) >= MAX_ADDRESS) { retire(l, mask); }
+            else { most = std::max(most, addr[l]); }
+        }
+    }
+    grow(size_t(most));
+
+    for (size_t l = 0; l < K; l++) {
+        if (mask[l]) { mem_[size_t(addr[l])*K + l] = val[l]; }
+    }
+}
+
+
+#endif // LOCKSTEP_HPP
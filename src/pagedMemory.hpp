@@ -0,0 +1,305 @@
+#ifndef PAGEDMEMORY_HPP
+#define PAGEDMEMORY_HPP
+
+
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <algorithm>
+#include <cstddef>
+
+
+/*
+Memory of an Intcode program, split into fixed-size pages of PAGE_SIZE
+integers. The pages holding the original program (the image) are filled by
+the constructor, every other page is allocated lazily on first write, so
+memory use is proportional to the addresses actually touched and an access to
+a far address costs O(1) instead of growing a dense vector up to it.
+
+Pages with a number below NEAR_PAGES are found through a directory indexed by
+page number (one pointer per page up to the highest near page touched), all
+others through a hash map.
+
+Pages are copy-on-write: a copy of a pagedMemory shares all pages with the
+original (copying costs one pointer per page, not the integers). A shared
+page is duplicated the first time one of the copies writes to it, so a copy
+only ever pays for the pages it modifies.
+
+--- CONSTRUCTOR ---
+
+# pagedMemory(const std::vector<T> & image)
+- Arguments:
+    image - original program, addresses 0 ... image.size()-1
+
+# pagedMemory(const T * image, size_t n, std::shared_ptr<const void> owner)
+- Arguments:
+    image, n - original program (n integers) in storage kept alive by owner,
+               e.g. a mapped image file (see intCodeImage.hpp)
+- the full pages of the image are not copied: they point into image and are
+  shared with owner, so the first write to one of them duplicates it like a
+  page shared with a copy. Only the last, partial page is copied
+
+# pagedMemory(size_t imageSize, size_t size)
+- empty memory (all 0) reporting the given sizes, the pages are filled with
+  pageAt() afterwards (e.g. to restore a saved machine, see intCode::save())
+
+
+--- FUNCTIONS ---
+
+# T * at(size_t addr)
+- Returns:
+    pointer to the integer at addr for writing. Allocates the page holding
+    addr if it was never written before and duplicates it if it is shared
+    with a copy. The pointer is valid until the next copy of the memory is
+    made
+
+# T read(size_t addr) const
+- Returns:
+    integer at addr, 0 for addresses that were never written (neither
+    allocates nor duplicates pages)
+
+# size_t size() const
+- Returns:
+    one past the highest address of the image or of any address written
+
+# std::vector<T> toVector() const
+- Returns:
+    dense copy of addresses 0 ... size()-1
+
+# void forEach(F f) const
+- calls f(addr, val) for every integer val != 0 in address order of the
+  near pages, then the far pages in no particular order. Pages never written
+  are skipped
+
+# void forEachPage(F f) const
+- calls f(num, cells) for every page: page number num and its PAGE_SIZE
+  integers cells (near pages in order, then the far pages)
+
+# T * pageAt(size_t num)
+- Returns:
+    the PAGE_SIZE integers of page number num for writing, allocated or
+    duplicated like at() does. Does not change size()
+
+# size_t getImageSize() const, size_t getPageCount() const
+- Returns:
+    size of the original program and number of pages (shared ones included)
+
+# size_t getAllocationCount() const
+- Returns:
+    number of heap allocations done since construction (new pages, shared
+    pages duplicated on write and page table growth). A page and its
+    reference count are allocated together (std::make_shared), one
+    allocation
+*/
+
+template<typename T>
+class pagedMemory {
+    public:
+        // Ctor
+        pagedMemory() = delete;
+        explicit pagedMemory(const std::vector<T> & image);
+        pagedMemory(const T *, size_t, std::shared_ptr<const void>);
+        pagedMemory(size_t imageSize, size_t size) :
+                imageSize_(imageSize), size_(size), pageCount_(0),
+                allocations_(0)
+        {}
+
+        // Getters
+        size_t size() const { return size_; }
+        size_t getImageSize() const { return imageSize_; }
+        size_t getPageCount() const { return pageCount_; }
+        size_t getAllocationCount() const { return allocations_; }
+
+        // Public Member
+        T * at(size_t addr) {
+            if (addr >= size_) { size_ = addr+1; }
+            size_t num = addr >> PAGE_BITS;
+            if (num < near_.size() && near_[num] &&
+                near_[num].use_count() == 1)
+            {
+                return &near_[num]->cell[addr & (PAGE_SIZE-1)];
+            }
+            return &writablePage(num).cell[addr & (PAGE_SIZE-1)];
+        }
+        T read(size_t addr) const {
+            size_t num = addr >> PAGE_BITS;
+            if (num < near_.size()) {
+                return near_[num] ? near_[num]->cell[addr & (PAGE_SIZE-1)] : 0;
+            }
+            return readFar(addr);
+        }
+        std::vector<T> toVector() const;
+        template<typename F> void forEach(F) const;
+        template<typename F> void forEachPage(F) const;
+        T * pageAt(size_t num) { return writablePage(num).cell; }
+
+        // Static Constants
+        static const size_t PAGE_BITS = 9;
+        static const size_t PAGE_SIZE = size_t(1) << PAGE_BITS;
+        static const size_t NEAR_PAGES = size_t(1) << 12;
+
+    private:
+        struct page {
+            T cell[PAGE_SIZE];
+        };
+
+        std::vector<std::shared_ptr<page>> near_; // directory, page number
+        std::unordered_map<size_t, std::shared_ptr<page>> far_;
+        std::shared_ptr<const void> owner_; // storage of borrowed pages
+        size_t imageSize_;
+        size_t size_;
+        size_t pageCount_;
+        size_t allocations_;
+
+        // Private Member
+        page & writablePage(size_t);
+        T readFar(size_t) const;
+};
+
+
+// ------------------------
+// --- MEMBER FUNCTIONS ---
+// ------------------------
+
+// --- PUBLIC ---
+
+template<typename T>
+pagedMemory<T>::pagedMemory(const std::vector<T> & image) :
+        imageSize_(image.size()), size_(image.size()), pageCount_(0),
+        allocations_(0)
+{
+    for (size_t addr = 0; addr < image.size(); addr += PAGE_SIZE) {
+        page & p = writablePage(addr >> PAGE_BITS);
+        size_t n = std::min(size_t(PAGE_SIZE), image.size() - addr);
+        std::copy(image.begin() + addr, image.begin() + addr + n, p.cell);
+    }
+
+    allocations_ = 0;
+}
+
+
+template<typename T>
+pagedMemory<T>::pagedMemory(const T * image, size_t n,
+                            std::shared_ptr<const void> owner) :
+        owner_(std::move(owner)), imageSize_(n), size_(n), pageCount_(0),
+        allocations_(0)
+{
+    // a borrowed page shares the control block of owner_, its use count is
+    // never 1 while owner_ is held, so at() never writes into the image
+
+    size_t full = n >> PAGE_BITS;
+    near_.resize(std::min(full, size_t(NEAR_PAGES)));
+
+    for (size_t num = 0; num < full; num++) {
+        page * p = const_cast<page *>(
+                       reinterpret_cast<const page *>(image + (num << PAGE_BITS)));
+        if (num < NEAR_PAGES) {
+            near_[num] = std::shared_ptr<page>(owner_, p);
+        } else {
+            far_[num] = std::shared_ptr<page>(owner_, p);
+        }
+    }
+    pageCount_ = full;
+
+    if (n > (full << PAGE_BITS)) {
+        page & p = writablePage(full);
+        std::copy(image + (full << PAGE_BITS), image + n, p.cell);
+    }
+
+    allocations_ = 0;
+}
+
+
+template<typename T>
+std::vector<T> pagedMemory<T>::toVector() const {
+    std::vector<T> res;
+    res.reserve(size_);
+    for (size_t addr = 0; addr < size_; addr++) {
+        res.push_back(read(addr));
+    }
+
+    return res;
+}
+
+
+template<typename T>
+template<typename F>
+void pagedMemory<T>::forEach(F f) const {
+    auto visit = [&](size_t num, const page & p) {
+        for (size_t i = 0; i < PAGE_SIZE; i++) {
+            if (p.cell[i] != 0) { f((num << PAGE_BITS) + i, p.cell[i]); }
+        }
+    };
+
+    for (size_t num = 0; num < near_.size(); num++) {
+        if (near_[num]) { visit(num, *near_[num]); }
+    }
+    for (const auto & entry: far_) {
+        visit(entry.first, *entry.second);
+    }
+}
+
+
+template<typename T>
+template<typename F>
+void pagedMemory<T>::forEachPage(F f) const {
+    for (size_t num = 0; num < near_.size(); num++) {
+        if (near_[num]) { f(num, near_[num]->cell); }
+    }
+    for (const auto & entry: far_) {
+        f(entry.first, entry.second->cell);
+    }
+}
+
+
+// --- PRIVATE ---
+
+template<typename T>
+typename pagedMemory<T>::page & pagedMemory<T>::writablePage(size_t num) {
+    // slow path of at(): page number num does not exist yet (allocated, all
+    // 0), is shared with a copy (duplicated) or is a far page
+
+    std::shared_ptr<page> * slot;
+
+    if (num < NEAR_PAGES) {
+        if (num >= near_.size()) {
+            size_t capacity = near_.capacity();
+            near_.resize(num+1);
+            if (near_.capacity() != capacity) { allocations_++; }
+        }
+        slot = &near_[num];
+    } else {
+        size_t buckets = far_.bucket_count();
+        auto res = far_.emplace(num, nullptr);
+        slot = &res.first->second;
+        if (res.second) { allocations_++; }
+        if (far_.bucket_count() != buckets) { allocations_++; }
+    }
+
+    if (!*slot) {
+        *slot = std::make_shared<page>();
+        pageCount_++;
+        allocations_++;
+    } else if (slot->use_count() > 1) {
+        *slot = std::make_shared<page>(**slot);
+        allocations_++;
+    }
+
+    return **slot;
+}
+
+
+template<typename T>
+T pagedMemory<T>::readFar(size_t addr) const {
+    // slow path of read(), addr lies beyond the page directory
+
+    auto it = far_.find(addr >> PAGE_BITS);
+    if (it == far_.end()) {
+        return 0;
+    }
+
+    return it->second->cell[addr & (PAGE_SIZE-1)];
+}
+
+
+#endif // PAGEDMEMORY_HPP
@@ -0,0 +1,220 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+
+
+/*
+Profiling policies for intCode<T, D, P>, see intCode.hpp. intCode calls
+
+    resume()                      - at the start of every runIntCode()
+    instruction(pos, opcode)      - for every instruction executed
+    fused(pos, n)                 - after a superinstruction of n
+                                    instructions starting at pos (each of
+                                    them was reported by instruction())
+    wait(pos, opcode, before)     - whenever runIntCode() returns at the
+                                    input or output instruction at pos:
+                                    before is true if it stops in front of
+                                    it (stop at input, empty input or full
+                                    output channel; the instruction was
+                                    reported but not executed, it will be
+                                    reported again on resume), false if it
+                                    stops right after it (stop at output)
+
+noProfiler (default) does nothing; its functions are empty inline members
+and intCode skips all profiling work when P::enabled is false, so it costs
+nothing.
+
+profiler counts the executed instructions per opcode, per program address
+and per basic block. A basic block starts at the first instruction of every
+runIntCode() call and after each jump instruction (taken or not); its count
+is the number of times it was entered.
+
+--- FUNCTIONS (profiler) ---
+
+# size_t getOpcodeCount(int opcode) const,
+  size_t getAddressCount(size_t pos) const,
+  size_t getBlockCount(size_t start) const
+- Returns:
+    instructions executed with opcode, instructions executed at pos, number
+    of times the basic block starting at start was entered
+
+# size_t getFusedCount() const, size_t getSuperinstructionCount() const
+- Returns:
+    instructions executed as part of a superinstruction, number of
+    superinstructions executed (compiledDispatch, see intCode.hpp). Their
+    ratio to the number of instructions is the fusion hit rate
+
+# size_t getInputWaits() const, size_t getOutputWaits() const
+- Returns:
+    number of returns from runIntCode() at an input / output instruction
+
+# void dumpCSV(std::ostream & out) const
+- writes lines "kind,key,count" with kind opcode (key: opcode name),
+  address (key: position), block (key: start), fused (key: instructions,
+  superinstructions) and wait (key: input, output)
+
+# void dumpFolded(std::ostream & out) const
+- writes folded stacks "intcode;block_<start>;<pos>_<opcode name> <count>"
+  (input for flamegraph.pl), one line per executed address. An address is
+  attributed to the closest block start in front of it
+*/
+
+struct noProfiler {
+    static const bool enabled = false;
+
+    void resume() {}
+    void instruction(size_t, int) {}
+    void fused(size_t, size_t) {}
+    void wait(size_t, int, bool) {}
+};
+
+
+class profiler {
+    public:
+        static const bool enabled = true;
+
+        // Ctor
+        profiler() : opcodes_(100, 0), newBlock_(true), entered_(false),
+                     fused_(0), superinstructions_(0), inputWaits_(0),
+                     outputWaits_(0)
+        {}
+
+        // Getters
+        size_t getOpcodeCount(int opcode) const {
+            return opcode >= 0 && opcode < 100 ? opcodes_[opcode] : 0;
+        }
+        size_t getAddressCount(size_t pos) const {
+            return pos < addresses_.size() ? addresses_[pos] : 0;
+        }
+        size_t getBlockCount(size_t start) const {
+            return start < blocks_.size() ? blocks_[start] : 0;
+        }
+        size_t getFusedCount() const { return fused_; }
+        size_t getSuperinstructionCount() const {
+            return superinstructions_;
+        }
+        size_t getInputWaits() const { return inputWaits_; }
+        size_t getOutputWaits() const { return outputWaits_; }
+
+        // Public Member
+        void resume() { newBlock_ = true; }
+        void instruction(size_t pos, int opcode) {
+            if (pos >= addresses_.size()) { grow(pos); }
+            opcodes_[opcode >= 0 && opcode < 100 ? opcode : 0]++;
+            addresses_[pos]++;
+            opcodeAt_[pos] = opcode;
+            if (newBlock_) { blocks_[pos]++; }
+            entered_ = newBlock_;
+            newBlock_ = opcode == 5 || opcode == 6; // JUMPTRUE, JUMPFALSE
+        }
+        void fused(size_t, size_t n) {
+            fused_ += n;
+            superinstructions_++;
+        }
+        void wait(size_t pos, int opcode, bool before) {
+            if (before) { // take back the last instruction()
+                opcodes_[opcode]--;
+                addresses_[pos]--;
+                if (entered_) { blocks_[pos]--; }
+            }
+            if (opcode == 3) { inputWaits_++; }
+            else { outputWaits_++; }
+        }
+        void dumpCSV(std::ostream &) const;
+        void dumpFolded(std::ostream &) const;
+
+    private:
+        std::vector<size_t> opcodes_; // by opcode
+        std::vector<size_t> addresses_; // by position
+        std::vector<int> opcodeAt_; // last opcode executed, by position
+        std::vector<size_t> blocks_; // by start position
+        bool newBlock_; // next instruction starts a basic block
+        bool entered_; // last instruction started a basic block
+        size_t fused_; // instructions executed within superinstructions
+        size_t superinstructions_;
+        size_t inputWaits_;
+        size_t outputWaits_;
+
+        // Private Member
+        void grow(size_t pos) {
+            addresses_.resize(std::max(pos+1, 2*addresses_.size()), 0);
+            blocks_.resize(addresses_.size(), 0);
+            opcodeAt_.resize(addresses_.size(), 0);
+        }
+        static std::string name(int);
+};
+
+
+// ------------------------
+// --- MEMBER FUNCTIONS ---
+// ------------------------
+
+// --- PUBLIC ---
+
+inline void profiler::dumpCSV(std::ostream & out) const {
+    out << "kind,key,count\n";
+
+    for (int op = 0; op < 100; op++) {
+        if (opcodes_[op] > 0) {
+            out << "opcode," << name(op) << "," << opcodes_[op] << "\n";
+        }
+    }
+    for (size_t pos = 0; pos < addresses_.size(); pos++) {
+        if (addresses_[pos] > 0) {
+            out << "address," << pos << "," << addresses_[pos] << "\n";
+        }
+    }
+    for (size_t pos = 0; pos < blocks_.size(); pos++) {
+        if (blocks_[pos] > 0) {
+            out << "block," << pos << "," << blocks_[pos] << "\n";
+        }
+    }
+
+    out << "fused,instructions," << fused_ << "\n";
+    out << "fused,superinstructions," << superinstructions_ << "\n";
+    out << "wait,input," << inputWaits_ << "\n";
+    out << "wait,output," << outputWaits_ << "\n";
+}
+
+
+inline void profiler::dumpFolded(std::ostream & out) const {
+    // the opcode named for an address is the one executed there last (they
+    // only differ for self-modifying code)
+
+    size_t block = 0;
+    for (size_t pos = 0; pos < addresses_.size(); pos++) {
+        if (blocks_[pos] > 0) { block = pos; }
+        if (addresses_[pos] > 0) {
+            out << "intcode;block_" << block << ";" << pos << "_"
+                << name(opcodeAt_[pos]) << " " << addresses_[pos] << "\n";
+        }
+    }
+}
+
+
+// --- PRIVATE ---
+
+inline std::string profiler::name(int opcode) {
+    switch (opcode) {
+        case 1: return "add";
+        case 2: return "multiply";
+        case 3: return "input";
+        case 4: return "output";
+        case 5: return "jumptrue";
+        case 6: return "jumpfalse";
+        case 7: return "less";
+        case 8: return "equal";
+        case 9: return "adjustbase";
+        case 99: return "halt";
+        default: return "invalid";
+    }
+}
+
+
+#endif // PROFILER_HPP
@@ -0,0 +1,112 @@
+#ifndef PROGRAMLOADER_HPP
+#define PROGRAMLOADER_HPP
+
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <charconv>
+#include <type_traits>
+#include <stdexcept>
+#include <cstddef>
+
+
+/*
+Reads an Intcode program in the text form of the puzzle inputs: integers
+separated by commas, e.g. "1,0,0,3,99". Blanks (spaces, tabs, line breaks)
+around the integers are skipped, a single trailing comma is accepted.
+
+The file is read into memory with a single read, the integers are counted
+from the commas so that the result is allocated once, and every integer is
+converted in place with std::from_chars (no std::string per integer, no
+locale, no exceptions while parsing), so large programs are parsed at close
+to the speed at which the file is read.
+
+--- FUNCTIONS ---
+
+# template<typename T> std::vector<T> loadProgram(const std::string & path)
+- Returns:
+    the program stored at path
+- throws std::runtime_error if the file cannot be read or is malformed, see
+  parseProgram()
+
+# template<typename T>
+  std::vector<T> parseProgram(const char * first, const char * last,
+                              const std::string & name = "program")
+- Returns:
+    the program in the characters [first, last)
+- throws std::runtime_error naming name and the byte offset (from first) of
+  the first malformed integer: not an integer, out of range for T, or not
+  followed by a comma
+*/
+
+inline const char * skipBlanks(const char * p, const char * last) {
+    while (p != last && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+    {
+        p++;
+    }
+
+    return p;
+}
+
+
+template<typename T>
+std::vector<T> parseProgram(const char * first, const char * last,
+                            const std::string & name = "program")
+{
+    static_assert(std::is_same<int, T>::value ||
+                  std::is_same<long, T>::value ||
+                  std::is_same<long long, T>::value,
+                  "ERROR: function parseProgram() must be called with template\
+                   parameter of type <signed int>, i.e., int, long, etc.");
+
+    auto fail = [&](const char * p, const std::string & what) {
+        throw std::runtime_error("parseProgram(): " + name + ", byte " +
+                                 std::to_string(p - first) + ": " + what);
+    };
+
+    std::vector<T> code;
+    code.reserve(std::count(first, last, ',') + 1);
+
+    const char * p = skipBlanks(first, last);
+    while (p != last) {
+        T val;
+        std::from_chars_result res = std::from_chars(p, last, val);
+        if (res.ec == std::errc::invalid_argument) {
+            fail(p, "expected an integer");
+        } else if (res.ec == std::errc::result_out_of_range) {
+            fail(p, "integer out of range");
+        }
+        code.push_back(val);
+
+        p = skipBlanks(res.ptr, last);
+        if (p == last) { break; }
+        if (*p != ',') { fail(p, "expected ','"); }
+        p = skipBlanks(p+1, last);
+    }
+
+    return code;
+}
+
+
+template<typename T>
+std::vector<T> loadProgram(const std::string & path) {
+    std::ifstream inFile(path, std::ios::binary);
+    if (!inFile.is_open()) {
+        throw std::runtime_error("loadProgram(): could not open file " + path);
+    }
+
+    inFile.seekg(0, std::ios::end);
+    std::string text(size_t(inFile.tellg()), '\0');
+    inFile.seekg(0);
+    inFile.read(&text[0], text.size());
+    if (!inFile) {
+        throw std::runtime_error("loadProgram(): could not read file " + path);
+    }
+
+    return parseProgram<T>(text.data(), text.data() + text.size(), path);
+}
+
+
+#endif // PROGRAMLOADER_HPP
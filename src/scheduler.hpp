@@ -0,0 +1,336 @@
+#ifndef SCHEDULER_HPP
+#define SCHEDULER_HPP
+
+
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <cstddef>
+
+#include "intCode.hpp"
+#include "channel.hpp"
+
+
+/*
+Runs a network of intCode machines connected by channels (see channel.hpp),
+e.g. the amplifier feedback loop of day 7. Every machine reads from its own
+input channel and writes to the input channel of the machine it is connected
+to (or to its own output channel if it is not connected).
+
+A machine is only resumed when it can make progress: it was never run, its
+input channel received a value while it was waiting for input, or its output
+channel got room while it was blocked on a full output channel. Ready
+machines are kept in a FIFO queue and every run of a machine wakes at most
+its consumer and the producers of its input channel, so a scheduling round
+costs O(ready machines), not O(all machines).
+
+With a quantum, a machine runs at most quantum instructions per turn (see
+intCode::run()) and goes to the back of the queue if it could continue, so a
+machine spinning in a long computation delays every other ready machine by
+one quantum at most instead of until its next input or output instruction.
+
+A machine that reaches the limit of its own setInstructionLimit() (see
+intCode) cannot continue until the limit is raised: it is not resumed again,
+run() reports it (LIMITED) and setInstructionLimit(m, n) of the scheduler
+raises the limit and queues the machine again.
+
+--- TEMPLATE PARAMETERS ---
+
+# scheduler<T, D = threadedDispatch>
+    T, D - see intCode<T, D>
+
+
+--- CONSTRUCTOR ---
+
+# scheduler(size_t capacity = 64, size_t quantum = size_t(-1))
+- Arguments:
+    capacity - capacity of every channel, see channel<T>
+    quantum - instructions a machine runs at most before the next ready
+              machine gets its turn. size_t(-1): no limit (default), a
+              machine runs until it halts or blocks
+
+
+--- FUNCTIONS ---
+
+# size_t addMachine(const intCode<T, D> & m)
+- Returns:
+    index of the machine (a copy of m) in the network, 0, 1, 2, ...
+
+# void connect(size_t from, size_t to)
+- outputs of machine from go to the input channel of machine to. Several
+  machines may write to the same machine
+
+# bool push(size_t m, const T & val)
+- passes val to the input channel of machine m from outside the network
+- Returns:
+    false if the channel is full
+
+# template<typename F> size_t drain(size_t m, F f)
+- calls f(val) for every value in the output channel of machine m (only
+  machines that were not connected), see channel<T>::drain()
+
+# int run()
+- runs ready machines until none is left
+- Returns:
+    HALTED - all machines halted
+    IDLE - all machines that did not halt wait for input that nobody will
+           send, the network can be resumed with push() and run()
+    DEADLOCK - additionally, at least one machine is blocked on a full
+               output channel (a cycle of full channels)
+    LIMITED - no machine is ready and at least one machine that did not
+              halt stands at the limit of its setInstructionLimit()
+
+# void setInstructionLimit(size_t m, size_t n)
+- machine m stops after n more instructions (see
+  intCode::setInstructionLimit()), a machine that stands at its limit is
+  queued again
+
+# bool isLimited(size_t m) const
+- machine m stands at the limit of its setInstructionLimit()
+
+# const intCode<T, D> & getMachine(size_t m) const,
+  const channel<T> & getInput(size_t m) const,
+  size_t getInstructionCount(size_t m) const
+- machine m, its input channel and the number of instructions it executed
+
+# size_t size() const, size_t getRunCount() const,
+  size_t getPreemptCount() const
+- number of machines, number of times a machine was resumed and number of
+  times a machine used up its quantum
+
+# size_t getMaxLatency() const
+- longest time a ready machine waited for its turn, counted in instructions
+  the other machines executed meanwhile
+*/
+
+template<typename T, typename D = threadedDispatch>
+class scheduler {
+    public:
+        // Ctor
+        explicit scheduler(size_t capacity = 64,
+                           size_t quantum = size_t(-1)) :
+                capacity_(capacity), quantum_(quantum), runs_(0),
+                preempts_(0), halted_(0), clock_(0), latency_(0)
+        {}
+
+        // Getters
+        size_t size() const { return machines_.size(); }
+        size_t getRunCount() const { return runs_; }
+        size_t getPreemptCount() const { return preempts_; }
+        size_t getMaxLatency() const { return latency_; }
+        const intCode<T, D> & getMachine(size_t m) const {
+            return machines_[m].vm;
+        }
+        const channel<T> & getInput(size_t m) const {
+            return channels_[machines_[m].in];
+        }
+        size_t getInstructionCount(size_t m) const {
+            return machines_[m].vm.getInstructionCount();
+        }
+        bool isLimited(size_t m) const { return machines_[m].limited; }
+
+        // Public Member
+        size_t addMachine(const intCode<T, D> &);
+        void connect(size_t, size_t);
+        bool push(size_t, const T &);
+        template<typename F> size_t drain(size_t, F);
+        void setInstructionLimit(size_t, size_t);
+        int run();
+
+        // Static Constants
+        static const int HALTED = 0; // return values of run()
+        static const int IDLE = 1;
+        static const int DEADLOCK = 2;
+        static const int LIMITED = 3;
+
+    private:
+        struct node {
+            intCode<T, D> vm;
+            size_t in; // index of the input channel
+            size_t out; // index of the output channel
+            bool queued; // in ready_
+            bool halted;
+            bool waitIn; // blocked on an empty input channel
+            bool waitOut; // blocked on a full output channel
+            bool limited; // at the limit of its setInstructionLimit()
+            size_t readyAt; // clock_ when queued
+        };
+
+        size_t capacity_;
+        size_t quantum_; // instructions per turn
+        std::vector<node> machines_;
+        std::deque<channel<T>> channels_; // stable addresses
+        std::vector<size_t> consumer_; // by channel, machine reading it
+        std::vector<std::vector<size_t>> producers_; // by channel
+        std::deque<size_t> ready_;
+        size_t runs_;
+        size_t preempts_;
+        size_t halted_;
+        size_t clock_; // instructions executed by all machines
+        size_t latency_; // longest wait in ready_, in instructions
+
+        // Private Member
+        size_t newChannel(size_t);
+        void wake(size_t);
+};
+
+
+// ------------------------
+// --- MEMBER FUNCTIONS ---
+// ------------------------
+
+// --- PUBLIC ---
+
+template<typename T, typename D>
+size_t scheduler<T, D>::addMachine(const intCode<T, D> & vm) {
+    size_t m = machines_.size();
+    machines_.push_back(node{vm, 0, 0, false, false, false, false, false, 0});
+
+    machines_[m].in = newChannel(m);
+    machines_[m].out = newChannel(size_t(-1));
+    producers_[machines_[m].out].push_back(m);
+
+    wake(m);
+    return m;
+}
+
+
+template<typename T, typename D>
+void scheduler<T, D>::connect(size_t from, size_t to) {
+    // the unused output channel of from stays empty
+
+    std::vector<size_t> & old = producers_[machines_[from].out];
+    for (size_t i = 0; i < old.size(); i++) {
+        if (old[i] == from) { old.erase(old.begin() + i); break; }
+    }
+
+    machines_[from].out = machines_[to].in;
+    producers_[machines_[to].in].push_back(from);
+}
+
+
+template<typename T, typename D>
+bool scheduler<T, D>::push(size_t m, const T & val) {
+    if (!channels_[machines_[m].in].push(val)) {
+        return false;
+    }
+
+    if (machines_[m].waitIn) { wake(m); }
+    return true;
+}
+
+
+template<typename T, typename D>
+template<typename F>
+size_t scheduler<T, D>::drain(size_t m, F f) {
+    size_t n = channels_[machines_[m].out].drain(f);
+
+    if (n > 0 && machines_[m].waitOut) { wake(m); }
+    return n;
+}
+
+
+template<typename T, typename D>
+void scheduler<T, D>::setInstructionLimit(size_t m, size_t n) {
+    machines_[m].vm.setInstructionLimit(n);
+    machines_[m].limited = false;
+    wake(m);
+}
+
+
+template<typename T, typename D>
+int scheduler<T, D>::run() {
+    // resumes ready machines in FIFO order. After a machine returns, the
+    // consumer of its output channel is woken if it waits for input and the
+    // channel holds a value, the producers of its input channel are woken if
+    // they are blocked and the channel has room. A machine that used up its
+    // quantum is queued again behind the others, a machine at its own limit
+    // is only queued again by setInstructionLimit()
+    // -----------------
+
+    while (!ready_.empty()) {
+        size_t m = ready_.front();
+        ready_.pop_front();
+
+        node & n = machines_[m];
+        n.queued = false;
+        if (n.halted) { continue; }
+
+        channel<T> & in = channels_[n.in];
+        channel<T> & out = channels_[n.out];
+
+        runs_++;
+        latency_ = std::max(latency_, clock_ - n.readyAt);
+        size_t executed = n.vm.getInstructionCount();
+        int status = n.vm.run(in, out, quantum_);
+        clock_ += n.vm.getInstructionCount() - executed;
+
+        if (status == intCode<T, D>::FINISHED) {
+            n.halted = true;
+            n.waitIn = false;
+            n.waitOut = false;
+            halted_++;
+        } else if (status == intCode<T, D>::EXHAUSTED) {
+            preempts_++;
+        } else if (n.vm.isAtLimit()) {
+            n.limited = true;
+        } else {
+            // blocked on input, on output or (both empty and full) either
+            n.waitIn = in.empty();
+            n.waitOut = out.full();
+        }
+
+        size_t c = consumer_[n.out];
+        if (c != size_t(-1) && !out.empty() && machines_[c].waitIn) {
+            wake(c);
+        }
+
+        if (!in.full()) {
+            for (size_t p: producers_[n.in]) {
+                if (machines_[p].waitOut) { wake(p); }
+            }
+        }
+
+        if (status == intCode<T, D>::EXHAUSTED) { wake(m); }
+    }
+
+    if (halted_ == machines_.size()) {
+        return HALTED;
+    }
+
+    int res = IDLE;
+    for (const node & n: machines_) {
+        if (n.limited) { return LIMITED; }
+        if (n.waitOut) { res = DEADLOCK; }
+    }
+
+    return res;
+}
+
+
+// --- PRIVATE ---
+
+template<typename T, typename D>
+size_t scheduler<T, D>::newChannel(size_t consumer) {
+    channels_.emplace_back(capacity_);
+    consumer_.push_back(consumer);
+    producers_.emplace_back();
+
+    return channels_.size()-1;
+}
+
+
+template<typename T, typename D>
+void scheduler<T, D>::wake(size_t m) {
+    node & n = machines_[m];
+    if (n.queued || n.halted) { return; }
+
+    n.queued = true;
+    n.waitIn = false;
+    n.waitOut = false;
+    n.readyAt = clock_;
+    ready_.push_back(m);
+}
+
+
+#endif // SCHEDULER_HPP
@@ -0,0 +1,850 @@
+#ifndef SPECIALIZER_HPP
+#define SPECIALIZER_HPP
+
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <tuple>
+#include <algorithm>
+#include <stdexcept>
+#include <cstddef>
+
+
+/*
+Partial evaluator of Intcode programs: runs a program whose memory and inputs
+are known except for some unknown cells (e.g. noun and verb of day 2) and
+unknown inputs (every input behind the known ones, e.g. the signal of an
+amplifier of day 7 whose phase is known), folds everything that does not
+depend on the unknowns and leaves a residual program that computes only the
+rest.
+
+--- SPECIALIZATION ---
+
+Every memory cell holds either a constant or an expression over the unknowns
+(expr: constants, unknown cells, unknown inputs, loads and the arithmetic of
+add, multiply, less and equal). The program runs from position 0 as long as
+its control flow is known; instructions on constants are executed, those on
+unknowns build expressions (folded and simplified: constants are collected,
+e.g. (x + 3) * 2 + 1 becomes x * 2 + 7, and equal expressions are shared).
+Reading through an unknown pointer becomes a load.
+
+Specialization stops, in front of the instruction concerned, at a jump whose
+condition or target is unknown, a write or adjustment of the relative base
+through an unknown value, an unknown instruction integer, an invalid
+instruction or after maxSteps instructions. It is complete if the program
+halted. Only a complete specialization has a residual program: continuing
+the original program from where specialization stopped would run it with
+the scratch cells and the residual code in memory, where it has zeros.
+
+--- RESIDUAL PROGRAM ---
+
+getResidual() is the original program with the residual code appended
+behind every address the specialization touched (getEntry(): where it
+starts, run it with intCode(residual, ..., getEntry())). The residual code
+- copies the unknown cells (they keep their addresses, patch them as in the
+  original program) and reads the unknown inputs
+- computes only the expressions needed, in program order: for every output,
+  every load whose value is used (memory is brought up to date before) and
+  at the end for every live cell whose final value differs from the image.
+  A load at or above the scratch cells reads 0, as in the original program
+  (every write of a complete specialization is below them)
+- then halts
+The outputs and the live cells end up as in the original program. Live are
+all cells below the scratch cells, or only liveCells if given, e.g. {0} for
+day 2: the residual then computes nothing but the final value of address 0.
+
+--- CLOSED FORM ---
+
+For a complete specialization the final value of every cell and every
+output is an expression over the unknowns. If it contains no load
+(isArithmetic()), evaluate() computes it directly from the values of the
+unknowns, without running any Intcode; format() prints it, e.g.
+"[1] * 360000 + [2] + 250635" for day 2 ([a]: unknown cell a, in0: first
+unknown input).
+
+--- CONSTRUCTOR ---
+
+# specializer(const std::vector<T> & image,
+              const std::vector<size_t> & unknownCells,
+              const std::vector<T> & knownInputs = {},
+              size_t maxSteps = 1 << 24)
+# specializer(const std::vector<T> & image,
+              const std::vector<size_t> & unknownCells,
+              const std::vector<T> & knownInputs,
+              const std::vector<size_t> & liveCells,
+              size_t maxSteps = 1 << 24)
+- Arguments:
+    image - original program
+    unknownCells - addresses whose value is not known
+    knownInputs - values of the first inputs, later inputs are unknown
+    liveCells - addresses whose final value is used, see RESIDUAL PROGRAM
+                (default: every address; {}: only the outputs)
+    maxSteps - limit of instructions executed during specialization
+
+
+--- FUNCTIONS ---
+
+# bool isComplete() const, size_t getStopPosition() const
+- true IFF the program halted during specialization, otherwise the position
+  specialization stopped at
+
+# const std::vector<T> & getResidual() const, size_t getEntry() const
+- residual program and the position it starts at. Throw std::runtime_error
+  unless isComplete()
+
+# size_t getFoldedCount() const, size_t getResidualCount() const
+- instructions executed during specialization, instructions of the residual
+  code (each executed once)
+
+# size_t getUnknownInputCount() const, size_t getOutputCount() const
+- inputs read by the residual code, outputs written
+
+# bool isArithmetic(size_t addr) const, bool isArithmeticOutput(size_t i)
+  const
+- complete, and the final value of cell addr (output i) contains no load
+
+# T evaluate(size_t addr, const std::vector<T> & cells,
+             const std::vector<T> & inputs = {}) const,
+  T evaluateOutput(size_t i, ...) const
+- final value of cell addr (output i) for the unknown cells holding cells
+  (in the order of unknownCells) and the unknown inputs inputs. Throws
+  std::runtime_error unless isArithmetic()
+
+# std::string format(size_t addr) const, std::string formatOutput(size_t i)
+  const
+- the expression as text
+
+# const std::vector<expr> & getExpressions() const,
+  size_t getValueNode(size_t addr) const, size_t getOutputNode(size_t i) const
+- all expression nodes (operands a, b are indices of earlier nodes) and the
+  node of the final value of cell addr (output i), e.g. to analyse the
+  closed form (see inverseSolver.hpp)
+*/
+
+template<typename T>
+class specializer {
+    public:
+        // node of an expression, operands are indices of earlier nodes
+        struct expr {
+            int op; // CONSTANT, CELL, INPUT, LOAD, ADD, MULTIPLY, LESS, EQUAL
+            T val; // CONSTANT: value, CELL: address, INPUT: index,
+                   // LOAD: own index (loads of different times differ)
+            size_t a;
+            size_t b;
+        };
+
+        // Ctor
+        specializer() = delete;
+        specializer(const std::vector<T> & image,
+                    const std::vector<size_t> & unknownCells,
+                    const std::vector<T> & knownInputs = {},
+                    size_t maxSteps = size_t(1) << 24) :
+                specializer(image, unknownCells, knownInputs, nullptr,
+                            maxSteps)
+        {}
+        specializer(const std::vector<T> & image,
+                    const std::vector<size_t> & unknownCells,
+                    const std::vector<T> & knownInputs,
+                    const std::vector<size_t> & liveCells,
+                    size_t maxSteps = size_t(1) << 24) :
+                specializer(image, unknownCells, knownInputs, &liveCells,
+                            maxSteps)
+        {}
+
+        // Getters
+        bool isComplete() const { return complete_; }
+        size_t getStopPosition() const { return pos_; }
+        const std::vector<T> & getResidual() const {
+            requireComplete();
+            return residual_;
+        }
+        size_t getEntry() const {
+            requireComplete();
+            return entry_;
+        }
+        size_t getFoldedCount() const { return folded_; }
+        size_t getResidualCount() const { return emitted_; }
+        size_t getUnknownInputCount() const { return unknownInputs_; }
+        size_t getOutputCount() const { return outputs_.size(); }
+        const std::vector<expr> & getExpressions() const { return nodes_; }
+        size_t getValueNode(size_t addr) const { return valueAt(addr); }
+        size_t getOutputNode(size_t i) const { return outputs_.at(i); }
+
+        // Public Member
+        bool isArithmetic(size_t addr) const {
+            return complete_ && !loads_[valueAt(addr)];
+        }
+        bool isArithmeticOutput(size_t i) const {
+            return complete_ && !loads_[outputs_.at(i)];
+        }
+        T evaluate(size_t addr, const std::vector<T> & cells,
+                   const std::vector<T> & inputs = {}) const {
+            return evaluateNode(valueAt(addr), cells, inputs);
+        }
+        T evaluateOutput(size_t i, const std::vector<T> & cells,
+                         const std::vector<T> & inputs = {}) const {
+            return evaluateNode(outputs_.at(i), cells, inputs);
+        }
+        std::string format(size_t addr) const {
+            return formatNode(valueAt(addr), 0);
+        }
+        std::string formatOutput(size_t i) const {
+            return formatNode(outputs_.at(i), 0);
+        }
+
+        // Static Constants
+        static const int CONSTANT = 0; // expr::op
+        static const int CELL = 1;
+        static const int INPUT = 2;
+        static const int LOAD = 3;
+        static const int ADD = 4;
+        static const int MULTIPLY = 5;
+        static const int LESS = 6;
+        static const int EQUAL = 7;
+
+    private:
+        struct cell {
+            size_t node; // value
+            bool dirty; // differs from the memory of the residual program
+            bool shown; // the memory of the residual program holds shownVal
+            T shownVal;
+        };
+
+        struct event { // step of the residual program, in program order
+            int kind; // COPY, READ, FETCH, STORE, PRINT
+            size_t node;
+            size_t addr; // STORE
+        };
+
+        struct operand {
+            int mode;
+            T val; // immediate value or address
+            int kind; // ABSOLUTE, SLOT (scratch cell), CODE (residual code)
+        };
+
+        std::vector<T> image_;
+        std::vector<cell> mem_; // grows with the highest address written
+        std::vector<expr> nodes_;
+        std::map<std::tuple<int, T, size_t, size_t>, size_t> known_;
+        std::vector<size_t> slot_; // by node: scratch cell, NONE if none
+        std::vector<char> loads_; // by node: depends on a load
+        std::vector<size_t> unknownCells_;
+        std::vector<size_t> dirty_; // addresses of dirty cells
+        std::vector<size_t> outputs_; // nodes
+        std::vector<T> knownInputs_;
+        size_t inputCount_; // inputs read
+        size_t unknownInputs_;
+        size_t pos_;
+        T relBase_;
+        bool complete_;
+        size_t folded_;
+        size_t zero_; // node of the constant 0
+        std::vector<event> events_;
+        bool allLive_;
+        std::vector<size_t> liveCells_;
+
+        // residual code, addresses relative to the scratch cells or the code
+        // itself until the layout is known
+        std::vector<T> code_;
+        std::vector<std::pair<size_t, int>> fixups_; // (index in code_, kind)
+        size_t slots_; // scratch cells
+        size_t emitted_;
+        std::vector<T> residual_;
+        size_t entry_;
+
+        specializer(const std::vector<T> &, const std::vector<size_t> &,
+                    const std::vector<T> &, const std::vector<size_t> *,
+                    size_t);
+
+        // Private Member
+        size_t node(int, T, size_t, size_t);
+        size_t constant(T val) { return node(CONSTANT, val, 0, 0); }
+        size_t fold(int, size_t, size_t);
+        bool isConstant(size_t n) const { return nodes_[n].op == CONSTANT; }
+        T valueOf(size_t n) const { return nodes_[n].val; }
+        size_t valueAt(size_t) const;
+        void write(size_t, size_t);
+        bool pointer(size_t, int, size_t &) const;
+        size_t load(size_t);
+        void specialize(size_t);
+        void materialize();
+        void generate();
+        operand use(size_t);
+        void emitNode(size_t);
+        void emit(int, std::initializer_list<operand>);
+        void layout();
+        T evaluateNode(size_t, const std::vector<T> &,
+                       const std::vector<T> &) const;
+        std::string formatNode(size_t, int) const;
+        void requireComplete() const {
+            if (!complete_) {
+                throw std::runtime_error("specializer: no residual program, "
+                                         "the specialization is incomplete");
+            }
+        }
+
+        // Static Constants
+        static const size_t NONE = size_t(-1);
+        static const size_t MAX_GROWTH = size_t(1) << 22; // memory written
+
+        static const int COPY = 0; // event::kind
+        static const int READ = 1;
+        static const int FETCH = 2;
+        static const int STORE = 3;
+        static const int PRINT = 4;
+
+        static const int ABSOLUTE = 0; // operand::kind
+        static const int SLOT = 1;
+        static const int CODE = 2;
+
+        static const int OP_ADD = 1;
+        static const int OP_MULTIPLY = 2;
+        static const int OP_INPUT = 3;
+        static const int OP_OUTPUT = 4;
+        static const int OP_JUMPTRUE = 5;
+        static const int OP_JUMPFALSE = 6;
+        static const int OP_LESS = 7;
+        static const int OP_EQUAL = 8;
+        static const int OP_ADJUSTBASE = 9;
+        static const int OP_HALT = 99;
+
+        static const int POSITION = 0;
+        static const int IMMEDIATE = 1;
+        static const int RELATIVE = 2;
+};
+
+
+// ------------------------
+// --- MEMBER FUNCTIONS ---
+// ------------------------
+
+// --- PRIVATE ---
+
+template<typename T>
+specializer<T>::specializer(const std::vector<T> & image,
+                            const std::vector<size_t> & unknownCells,
+                            const std::vector<T> & knownInputs,
+                            const std::vector<size_t> * liveCells,
+                            size_t maxSteps) :
+        image_(image), unknownCells_(unknownCells),
+        knownInputs_(knownInputs), inputCount_(0),
+        unknownInputs_(0), pos_(0), relBase_(0), complete_(false), folded_(0),
+        allLive_(liveCells == nullptr), slots_(0), emitted_(0), entry_(0)
+{
+    if (liveCells) { liveCells_ = *liveCells; }
+
+    zero_ = constant(0);
+    mem_.resize(image_.size());
+    for (size_t addr = 0; addr < image_.size(); addr++) {
+        mem_[addr] = cell{constant(image_[addr]), false, true, image_[addr]};
+    }
+
+    // the residual code starts by copying the unknown cells, later writes
+    // to them must not change what the expressions read
+    for (size_t addr: unknownCells) {
+        if (addr >= mem_.size()) {
+            mem_.resize(addr+1, cell{zero_, false, true, 0});
+        }
+        size_t n = node(CELL, T(addr), 0, 0);
+        mem_[addr] = cell{n, false, false, 0};
+        events_.push_back(event{COPY, n, addr});
+    }
+
+    specialize(maxSteps);
+    if (complete_) {
+        generate();
+        layout();
+    }
+}
+
+
+template<typename T>
+size_t specializer<T>::node(int op, T val, size_t a, size_t b) {
+    // the node (op, val, a, b), created if it does not exist yet
+
+    auto key = std::make_tuple(op, val, a, b);
+    auto it = known_.find(key);
+    if (it != known_.end()) { return it->second; }
+
+    nodes_.push_back(expr{op, val, a, b});
+    slot_.push_back(size_t(NONE));
+    loads_.push_back(op == LOAD || (op >= ADD && (loads_[a] || loads_[b])));
+    known_.emplace(key, nodes_.size()-1);
+
+    return nodes_.size()-1;
+}
+
+
+template<typename T>
+size_t specializer<T>::fold(int op, size_t a, size_t b) {
+    // node for a op b: evaluated if both are constant, otherwise simplified
+    // so that constants collect at the top (x + c, x * c)
+    // -----------------
+
+    if (isConstant(a) && isConstant(b)) {
+        T x = valueOf(a);
+        T y = valueOf(b);
+        return constant(op == ADD ? x + y : op == MULTIPLY ? x * y :
+                        op == LESS ? T(x < y) : T(x == y));
+    }
+    if (op == LESS || op == EQUAL) { return node(op, 0, a, b); }
+
+    if (isConstant(a)) { std::swap(a, b); } // constant right
+    const expr x = nodes_[a]; // copies, creating nodes moves nodes_
+
+    if (isConstant(b)) {
+        T c = valueOf(b);
+        if (op == ADD) {
+            if (c == 0) { return a; }
+            if (x.op == ADD && isConstant(x.b)) { // (y + c1) + c
+                size_t sum = constant(valueOf(x.b) + c);
+                return fold(ADD, x.a, sum);
+            }
+        } else {
+            if (c == 0) { return constant(0); }
+            if (c == 1) { return a; }
+            if (x.op == MULTIPLY && isConstant(x.b)) { // (y * c1) * c
+                size_t prod = constant(valueOf(x.b) * c);
+                return fold(MULTIPLY, x.a, prod);
+            }
+            if (x.op == ADD && isConstant(x.b)) { // (y + c1) * c
+                size_t m = fold(MULTIPLY, x.a, b);
+                return fold(ADD, m, constant(valueOf(x.b) * c));
+            }
+        }
+        return node(op, 0, a, b);
+    }
+
+    // two unknown operands: move a constant term of either one outwards
+    if (op == ADD) {
+        const expr y = nodes_[b];
+        if (x.op == ADD && isConstant(x.b)) { // (u + c) + v
+            return fold(ADD, fold(ADD, x.a, b), x.b);
+        }
+        if (y.op == ADD && isConstant(y.b)) { // u + (v + c)
+            return fold(ADD, fold(ADD, a, y.a), y.b);
+        }
+    }
+
+    return node(op, 0, a, b);
+}
+
+
+template<typename T>
+size_t specializer<T>::valueAt(size_t addr) const {
+    return addr < mem_.size() ? mem_[addr].node : zero_;
+}
+
+
+template<typename T>
+void specializer<T>::write(size_t addr, size_t n) {
+    if (addr >= mem_.size()) {
+        mem_.resize(addr+1, cell{zero_, false, true, 0});
+    }
+
+    cell & c = mem_[addr];
+    c.node = n;
+    bool dirty = !(isConstant(n) && c.shown && c.shownVal == valueOf(n));
+    if (dirty && !c.dirty) { dirty_.push_back(addr); }
+    c.dirty = dirty;
+}
+
+
+template<typename T>
+bool specializer<T>::pointer(size_t i, int mode, size_t & addr) const {
+    // address parameter i of the instruction at pos_ refers to, false if it
+    // is not known. Immediate mode refers to the parameter itself
+
+    size_t at = pos_ + 1 + i;
+    if (mode == IMMEDIATE) {
+        addr = at;
+        return true;
+    }
+
+    size_t n = valueAt(at);
+    if (!isConstant(n)) { return false; }
+
+    T val = valueOf(n) + (mode == RELATIVE ? relBase_ : 0);
+    if (val < 0) { return false; }
+    addr = size_t(val);
+    return true;
+}
+
+
+template<typename T>
+size_t specializer<T>::load(size_t i) {
+    // value read by position/relative parameter i through an unknown pointer:
+    // the memory of the residual program is brought up to date and the load
+    // happens right here (a later write must not change what it reads)
+
+    int mode = int(valueOf(valueAt(pos_)) / (i == 0 ? 100 : 1000) % 10);
+    size_t ptr = valueAt(pos_ + 1 + i);
+    if (mode == RELATIVE) { ptr = fold(ADD, ptr, constant(relBase_)); }
+
+    materialize();
+    size_t n = node(LOAD, T(nodes_.size()), ptr, 0); // never shared
+    events_.push_back(event{FETCH, n, 0});
+
+    return n;
+}
+
+
+template<typename T>
+void specializer<T>::specialize(size_t maxSteps) {
+    // abstract run, see SPECIALIZATION. Every check that can stop it is done
+    // before the instruction changes anything
+
+    while (folded_ < maxSteps) {
+        size_t wordNode = valueAt(pos_);
+        if (!isConstant(wordNode)) { break; }
+
+        T word = valueOf(wordNode);
+        int opcode = int(word % 100);
+        int mode[3] = {int(word / 100 % 10), int(word / 1000 % 10),
+                       int(word / 10000 % 10)};
+        if (word < 0 || mode[0] > RELATIVE || mode[1] > RELATIVE ||
+            mode[2] > RELATIVE)
+        {
+            break;
+        }
+
+        // value of parameter i, a load if the pointer is unknown
+        auto value = [&](size_t i) {
+            size_t addr;
+            return pointer(i, mode[i], addr) ? valueAt(addr) : load(i);
+        };
+
+        size_t target;
+        if (opcode == OP_ADD || opcode == OP_MULTIPLY || opcode == OP_LESS ||
+            opcode == OP_EQUAL)
+        {
+            if (!pointer(2, mode[2], target) ||
+                target >= image_.size() + MAX_GROWTH)
+            {
+                break;
+            }
+            int op = opcode == OP_ADD ? ADD : opcode == OP_MULTIPLY ?
+                     MULTIPLY : opcode == OP_LESS ? LESS : EQUAL;
+            size_t a = value(0);
+            size_t b = value(1);
+            write(target, fold(op, a, b));
+            pos_ += 4;
+
+        } else if (opcode == OP_INPUT) {
+            if (!pointer(0, mode[0], target) ||
+                target >= image_.size() + MAX_GROWTH)
+            {
+                break;
+            }
+            size_t n;
+            if (inputCount_ < knownInputs_.size()) {
+                n = constant(knownInputs_[inputCount_]);
+            } else {
+                n = node(INPUT, T(unknownInputs_++), 0, 0);
+                events_.push_back(event{READ, n, 0});
+            }
+            inputCount_++;
+            write(target, n);
+            pos_ += 2;
+
+        } else if (opcode == OP_OUTPUT) {
+            size_t n = value(0);
+            events_.push_back(event{PRINT, n, 0});
+            outputs_.push_back(n);
+            pos_ += 2;
+
+        } else if (opcode == OP_JUMPTRUE || opcode == OP_JUMPFALSE) {
+            size_t addrCond, addrTarget;
+            if (!pointer(0, mode[0], addrCond) ||
+                !pointer(1, mode[1], addrTarget) ||
+                !isConstant(valueAt(addrCond)) ||
+                !isConstant(valueAt(addrTarget)))
+            {
+                break;
+            }
+            bool jump = (valueOf(valueAt(addrCond)) != 0) ==
+                        (opcode == OP_JUMPTRUE);
+            T to = valueOf(valueAt(addrTarget));
+            if (jump && to < 0) { break; }
+            pos_ = jump ? size_t(to) : pos_ + 3;
+
+        } else if (opcode == OP_ADJUSTBASE) {
+            size_t addr;
+            if (!pointer(0, mode[0], addr) || !isConstant(valueAt(addr))) {
+                break;
+            }
+            relBase_ += valueOf(valueAt(addr));
+            pos_ += 2;
+
+        } else if (opcode == OP_HALT) {
+            complete_ = true;
+            break;
+
+        } else {
+            break;
+        }
+
+        folded_++;
+    }
+
+    materialize();
+}
+
+
+template<typename T>
+void specializer<T>::materialize() {
+    // writes every dirty cell in the memory of the residual program
+
+    for (size_t addr: dirty_) {
+        cell & c = mem_[addr];
+        if (!c.dirty) { continue; }
+
+        events_.push_back(event{STORE, c.node, addr});
+
+        c.dirty = false;
+        c.shown = isConstant(c.node);
+        c.shownVal = c.shown ? valueOf(c.node) : 0;
+    }
+
+    dirty_.clear();
+}
+
+
+template<typename T>
+void specializer<T>::generate() {
+    // residual code of the events that matter, found backwards: outputs and
+    // inputs always, the last write of a live cell, every load whose value
+    // is needed and every write in front of such a load (it may read it)
+    // -----------------
+
+    std::vector<char> needed(nodes_.size(), 0);
+    auto mark = [&](size_t root) { // root and its operands
+        std::vector<size_t> todo{root};
+        while (!todo.empty()) {
+            size_t n = todo.back();
+            todo.pop_back();
+            if (needed[n]) { continue; }
+            needed[n] = 1;
+
+            const expr & e = nodes_[n];
+            if (e.op >= ADD || e.op == LOAD) { todo.push_back(e.a); }
+            if (e.op >= ADD) { todo.push_back(e.b); }
+        }
+    };
+
+    std::sort(liveCells_.begin(), liveCells_.end());
+    std::vector<char> written(mem_.size(), 0);
+
+    std::vector<char> keep(events_.size(), 0);
+    bool loadLater = false;
+    for (size_t i = events_.size(); i-- > 0; ) {
+        const event & ev = events_[i];
+
+        if (ev.kind == STORE) {
+            bool last = !written[ev.addr];
+            written[ev.addr] = 1;
+            keep[i] = loadLater || (last && (allLive_ ||
+                      std::binary_search(liveCells_.begin(), liveCells_.end(),
+                                         ev.addr)));
+        } else if (ev.kind == FETCH || ev.kind == COPY) {
+            keep[i] = needed[ev.node];
+            loadLater = loadLater || (keep[i] && ev.kind == FETCH);
+        } else {
+            keep[i] = 1;
+        }
+
+        if (keep[i]) { mark(ev.node); }
+    }
+
+    for (size_t i = 0; i < events_.size(); i++) {
+        if (!keep[i]) { continue; }
+
+        const event & ev = events_[i];
+        emitNode(ev.node);
+        if (ev.kind == STORE) {
+            emit(OP_ADD, {use(ev.node), operand{IMMEDIATE, 0, ABSOLUTE},
+                          operand{POSITION, T(ev.addr), ABSOLUTE}});
+        } else if (ev.kind == PRINT) {
+            emit(OP_OUTPUT, {use(ev.node)});
+        }
+    }
+
+    emit(OP_HALT, {});
+}
+
+
+template<typename T>
+typename specializer<T>::operand specializer<T>::use(size_t n) {
+    // operand reading the value of node n (emitted before)
+
+    if (isConstant(n)) { return operand{IMMEDIATE, valueOf(n), ABSOLUTE}; }
+    return operand{POSITION, T(slot_[n]), SLOT};
+}
+
+
+template<typename T>
+void specializer<T>::emitNode(size_t root) {
+    // emits the code computing root and every operand not computed yet into
+    // scratch cells, operands first (explicit stack, expressions can be
+    // deep)
+
+    std::vector<std::pair<size_t, bool>> todo{{root, false}};
+    while (!todo.empty()) {
+        size_t n = todo.back().first;
+        bool ready = todo.back().second;
+        todo.pop_back();
+
+        const expr e = nodes_[n];
+        if (e.op == CONSTANT || slot_[n] != NONE) { continue; }
+
+        bool binary = e.op >= ADD;
+        if (!ready && (binary || e.op == LOAD)) {
+            todo.push_back({n, true});
+            todo.push_back({e.a, false});
+            if (binary) { todo.push_back({e.b, false}); }
+            continue;
+        }
+
+        size_t slot = slots_++;
+        operand out{POSITION, T(slot), SLOT};
+
+        if (e.op == CELL) {
+            emit(OP_ADD, {operand{POSITION, e.val, ABSOLUTE},
+                          operand{IMMEDIATE, 0, ABSOLUTE}, out});
+        } else if (e.op == INPUT) {
+            emit(OP_INPUT, {out});
+        } else if (e.op == LOAD) {
+            // writes the pointer into the parameter of the next instruction,
+            // then multiplies the value by (pointer < first scratch cell)
+            T param = T(code_.size() + 4 + 1);
+            operand below{POSITION, T(slots_++), SLOT};
+            emit(OP_ADD, {use(e.a), operand{IMMEDIATE, 0, ABSOLUTE},
+                          operand{POSITION, param, CODE}});
+            emit(OP_ADD, {operand{POSITION, 0, ABSOLUTE},
+                          operand{IMMEDIATE, 0, ABSOLUTE}, out});
+            emit(OP_LESS, {use(e.a), operand{IMMEDIATE, 0, SLOT}, below});
+            emit(OP_MULTIPLY, {out, below, out});
+        } else {
+            int opcode = e.op == ADD ? OP_ADD : e.op == MULTIPLY ?
+                         OP_MULTIPLY : e.op == LESS ? OP_LESS : OP_EQUAL;
+            emit(opcode, {use(e.a), use(e.b), out});
+        }
+
+        slot_[n] = slot;
+    }
+}
+
+
+template<typename T>
+void specializer<T>::emit(int opcode, std::initializer_list<operand> ops) {
+    T word = opcode;
+    T scale = 100;
+    for (const operand & o: ops) {
+        word += scale * o.mode;
+        scale *= 10;
+    }
+
+    code_.push_back(word);
+    for (const operand & o: ops) {
+        if (o.kind != ABSOLUTE) { fixups_.push_back({code_.size(), o.kind}); }
+        code_.push_back(o.val);
+    }
+
+    emitted_++;
+}
+
+
+template<typename T>
+void specializer<T>::layout() {
+    // original program, the scratch cells behind every touched address and
+    // the residual code behind them
+
+    size_t base = std::max(image_.size(), mem_.size());
+    entry_ = base + slots_;
+
+    residual_ = image_;
+    residual_.resize(entry_, 0);
+    for (const auto & f: fixups_) {
+        code_[f.first] += T(f.second == SLOT ? base : entry_);
+    }
+    residual_.insert(residual_.end(), code_.begin(), code_.end());
+}
+
+
+template<typename T>
+T specializer<T>::evaluateNode(size_t root, const std::vector<T> & cells,
+                               const std::vector<T> & inputs) const
+{
+    // marks root and its operands, then evaluates the marked nodes in the
+    // order they were created (operands first)
+    // -----------------
+
+    if (!complete_ || loads_[root]) {
+        throw std::runtime_error("specializer::evaluate(): no closed form");
+    }
+
+    std::vector<char> used(root+1, 0);
+    std::vector<size_t> todo{root};
+    size_t first = root;
+    while (!todo.empty()) {
+        size_t n = todo.back();
+        todo.pop_back();
+        if (used[n]) { continue; }
+        used[n] = 1;
+        first = std::min(first, n);
+        if (nodes_[n].op >= ADD) {
+            todo.push_back(nodes_[n].a);
+            todo.push_back(nodes_[n].b);
+        }
+    }
+
+    std::vector<T> val(root+1, 0);
+    for (size_t n = first; n <= root; n++) {
+        if (!used[n]) { continue; }
+
+        const expr & e = nodes_[n];
+        size_t k = 0;
+        switch (e.op) {
+            case CONSTANT: val[n] = e.val; break;
+            case CELL:
+                while (unknownCells_[k] != size_t(e.val)) { k++; }
+                val[n] = cells.at(k);
+                break;
+            case INPUT: val[n] = inputs.at(size_t(e.val)); break;
+            case ADD: val[n] = val[e.a] + val[e.b]; break;
+            case MULTIPLY: val[n] = val[e.a] * val[e.b]; break;
+            case LESS: val[n] = val[e.a] < val[e.b]; break;
+            case EQUAL: val[n] = val[e.a] == val[e.b]; break;
+        }
+    }
+
+    return val[root];
+}
+
+
+template<typename T>
+std::string specializer<T>::formatNode(size_t n, int outer) const {
+    // precedence: 0 comparison, 1 sum, 2 product. Parenthesized if it binds
+    // weaker than the expression around it
+
+    const expr & e = nodes_[n];
+    switch (e.op) {
+        case CONSTANT: return std::to_string(e.val);
+        case CELL: return "[" + std::to_string(e.val) + "]";
+        case INPUT: return "in" + std::to_string(e.val);
+        case LOAD: return "mem[" + formatNode(e.a, 0) + "]";
+    }
+
+    int prec = e.op == ADD ? 1 : e.op == MULTIPLY ? 2 : 0;
+    const char * sym = e.op == ADD ? " + " : e.op == MULTIPLY ? " * " :
+                       e.op == LESS ? " < " : " == ";
+    std::string res = formatNode(e.a, prec == 0 ? 1 : prec) + sym +
+                      formatNode(e.b, prec == 0 ? 1 : prec);
+
+    return prec < outer || (prec == 0 && outer > 0) ? "(" + res + ")" : res;
+}
+
+
+#endif // SPECIALIZER_HPP
@@ -0,0 +1,106 @@
+#ifndef SPSCQUEUE_HPP
+#define SPSCQUEUE_HPP
+
+
+#include <vector>
+#include <atomic>
+#include <cstddef>
+
+
+/*
+Bounded lock-free queue between exactly one producer thread and one consumer
+thread, on a ring buffer like channel<T> (see channel.hpp). push() and pop()
+neither lock nor allocate: the producer owns tail_, the consumer owns head_,
+each publishes its index with a release store and reads the other one with
+an acquire load. Both indices sit on cache lines of their own, and each side
+keeps a private copy of the other side's index that it refreshes only when
+the queue looks full (producer) or empty (consumer), so the two cores do not
+bounce a cache line on every value.
+
+Waiting for a value or for room is up to the caller (see threadedScheduler.hpp,
+which spins, then parks the thread).
+
+--- CONSTRUCTOR ---
+
+# spscQueue(size_t capacity = 64)
+- Arguments:
+    capacity - maximum number of values held at the same time, rounded up to
+               the next power of two
+
+
+--- FUNCTIONS ---
+
+# bool push(const T & val)
+- producer only. Returns false if the queue is full (val is not stored)
+
+# bool pop(T & val)
+- consumer only. Returns false if the queue is empty
+
+# bool empty() const, bool full() const, size_t size() const,
+  size_t capacity() const
+- a snapshot, exact only while neither side runs concurrently
+*/
+
+template<typename T>
+class spscQueue {
+    public:
+        // Ctor
+        explicit spscQueue(size_t capacity = 64) :
+                head_(0), tailSeen_(0), tail_(0), headSeen_(0)
+        {
+            size_t n = 1;
+            while (n < capacity) { n <<= 1; }
+            buf_.resize(n);
+            mask_ = n-1;
+        }
+        spscQueue(const spscQueue &) = delete;
+        spscQueue & operator=(const spscQueue &) = delete;
+
+        // Getters
+        size_t size() const {
+            return tail_.load(std::memory_order_acquire) -
+                   head_.load(std::memory_order_acquire);
+        }
+        bool empty() const { return size() == 0; }
+        bool full() const { return size() == buf_.size(); }
+        size_t capacity() const { return buf_.size(); }
+
+        // Public Member
+        bool push(const T & val) {
+            size_t tail = tail_.load(std::memory_order_relaxed);
+            if (tail - headSeen_ == buf_.size()) {
+                headSeen_ = head_.load(std::memory_order_acquire);
+                if (tail - headSeen_ == buf_.size()) { return false; }
+            }
+            buf_[tail & mask_] = val;
+            tail_.store(tail+1, std::memory_order_release);
+            return true;
+        }
+        bool pop(T & val) {
+            size_t head = head_.load(std::memory_order_relaxed);
+            if (head == tailSeen_) {
+                tailSeen_ = tail_.load(std::memory_order_acquire);
+                if (head == tailSeen_) { return false; }
+            }
+            val = buf_[head & mask_];
+            head_.store(head+1, std::memory_order_release);
+            return true;
+        }
+
+    private:
+        static const size_t LINE = 64; // bytes per cache line
+
+        std::vector<T> buf_;
+        size_t mask_;
+
+        // consumer side
+        alignas(LINE) std::atomic<size_t> head_; // values popped so far
+        size_t tailSeen_; // last tail_ read
+
+        // producer side
+        alignas(LINE) std::atomic<size_t> tail_; // values pushed so far
+        size_t headSeen_; // last head_ read
+};
+
+
+#endif // SPSCQUEUE_HPP
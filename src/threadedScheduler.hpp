@@ -0,0 +1,397 @@
+#ifndef THREADEDSCHEDULER_HPP
+#define THREADEDSCHEDULER_HPP
+
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <stdexcept>
+#include <cstddef>
+
+#include "intCode.hpp"
+#include "channel.hpp"
+#include "spscQueue.hpp"
+
+
+/*
+Runs a network of intCode machines like scheduler<T, D> (see scheduler.hpp),
+every machine on a thread of its own, e.g. long amplifier chains of day 7
+spread over all cores. Machines pass values through lock-free single
+producer single consumer queues (see spscQueue.hpp), so every input queue
+has at most one machine writing to it.
+
+A thread moves the values waiting in the input queue of its machine to a
+local channel, runs the machine on it (runIntCode(channel<T> &, channel<T> &))
+and moves the outputs to the input queue of the next machine. A thread that
+waits for input (or for room in a full queue) spins on the queue for SPINS
+rounds, yields YIELDS times and then parks on a condition variable until the
+thread at the other end of the queue wakes it. Parking is rare while values
+flow, waking costs an atomic load if the other side does not sleep.
+
+run() returns once every machine halted, stands at the limit of its own
+setInstructionLimit() or is parked with nothing left to wake it, then all
+threads are joined (the machines keep their state for the next run()).
+
+--- TEMPLATE PARAMETERS ---
+
+# threadedScheduler<T, D = threadedDispatch>
+    T, D - see intCode<T, D>
+
+
+--- CONSTRUCTOR ---
+
+# threadedScheduler(size_t capacity = 64)
+- Arguments:
+    capacity - capacity of every queue, see spscQueue<T>
+
+
+--- FUNCTIONS ---
+
+# size_t addMachine(const intCode<T, D> & m)
+- Returns:
+    index of the machine (a copy of m) in the network, 0, 1, 2, ...
+
+# void connect(size_t from, size_t to)
+- outputs of machine from go to the input queue of machine to. Throws if
+  another machine writes to machine to already
+
+# bool push(size_t m, const T & val)
+- passes val to the input queue of machine m from outside the network (not
+  during run())
+- Returns:
+    false if the queue is full
+
+# template<typename F> size_t drain(size_t m, F f)
+- calls f(val) for every value in the output queue of machine m (only
+  machines that were not connected, not during run())
+
+# int run()
+- runs all machines until the network is quiet
+- Returns:
+    HALTED, IDLE, DEADLOCK, LIMITED - see scheduler<T, D>::run()
+
+# void setInstructionLimit(size_t m, size_t n), bool isLimited(size_t m)
+  const
+- see scheduler<T, D> (not during run())
+
+# const intCode<T, D> & getMachine(size_t m) const,
+  size_t getPending(size_t m) const,
+  size_t getInstructionCount(size_t m) const
+- machine m, the number of inputs it did not read yet and the number of
+  instructions it executed
+
+# size_t size() const, size_t getParkCount() const
+- number of machines and number of times a thread parked
+*/
+
+template<typename T, typename D = threadedDispatch>
+class threadedScheduler {
+    public:
+        // Ctor
+        explicit threadedScheduler(size_t capacity = 64) :
+                capacity_(capacity), idle_(0), stop_(false), parks_(0)
+        {}
+        threadedScheduler(const threadedScheduler &) = delete;
+        threadedScheduler & operator=(const threadedScheduler &) = delete;
+
+        // Getters
+        size_t size() const { return machines_.size(); }
+        size_t getParkCount() const { return parks_.load(); }
+        const intCode<T, D> & getMachine(size_t m) const {
+            return machines_[m].vm;
+        }
+        size_t getPending(size_t m) const {
+            return machines_[m].local.size() + machines_[m].in.size();
+        }
+        size_t getInstructionCount(size_t m) const {
+            return machines_[m].vm.getInstructionCount();
+        }
+        bool isLimited(size_t m) const { return machines_[m].limited; }
+
+        // Public Member
+        size_t addMachine(const intCode<T, D> &);
+        void connect(size_t, size_t);
+        bool push(size_t, const T &);
+        template<typename F> size_t drain(size_t, F);
+        void setInstructionLimit(size_t m, size_t n) {
+            machines_[m].vm.setInstructionLimit(n);
+            machines_[m].limited = false;
+        }
+        int run();
+
+        // Static Constants
+        static const int HALTED = 0; // return values of run()
+        static const int IDLE = 1;
+        static const int DEADLOCK = 2;
+        static const int LIMITED = 3;
+
+        static const unsigned SPINS = 256; // polls before yielding
+        static const unsigned YIELDS = 16; // yields before parking
+
+    private:
+        static const size_t NONE = size_t(-1);
+
+        struct node {
+            node(const intCode<T, D> & m, size_t capacity) :
+                    vm(m), in(capacity), out(capacity), local(capacity),
+                    results(capacity), queue(&out), producer(NONE),
+                    consumer(NONE), halted(false), limited(false),
+                    waitOut(false), sleeping(false)
+            {}
+
+            intCode<T, D> vm;
+            spscQueue<T> in; // inputs from the producer or push()
+            spscQueue<T> out; // outputs if not connected
+            channel<T> local; // inputs moved out of in
+            channel<T> results; // outputs not moved to queue yet
+            spscQueue<T> * queue; // out or input queue of the consumer
+            size_t producer; // machine writing to in
+            size_t consumer; // machine reading from queue
+            bool halted; // the program halted (results may be left)
+            bool limited; // at the limit of its setInstructionLimit()
+            bool waitOut; // parked on a full queue
+
+            std::mutex mu;
+            std::condition_variable cv;
+            std::atomic<bool> sleeping; // parked, cleared by the waker
+        };
+
+        size_t capacity_;
+        std::deque<node> machines_; // stable addresses
+
+        std::atomic<size_t> idle_; // machines parked or halted
+        std::atomic<bool> stop_;
+        std::atomic<size_t> parks_;
+        std::mutex doneMu_;
+        std::condition_variable doneCv_;
+
+        // Private Member
+        static bool stopped(const node & n) { // nothing left to do
+            return (n.halted || n.limited) && n.results.empty();
+        }
+        void work(size_t);
+        template<typename C> bool park(node &, C);
+        void wake(size_t);
+        void becomeIdle();
+};
+
+
+// ------------------------
+// --- MEMBER FUNCTIONS ---
+// ------------------------
+
+// --- PUBLIC ---
+
+template<typename T, typename D>
+size_t threadedScheduler<T, D>::addMachine(const intCode<T, D> & vm) {
+    machines_.emplace_back(vm, capacity_);
+    return machines_.size()-1;
+}
+
+
+template<typename T, typename D>
+void threadedScheduler<T, D>::connect(size_t from, size_t to) {
+    if (machines_[to].producer != NONE) {
+        throw std::runtime_error("threadedScheduler: a queue takes values "
+                                 "from one machine only");
+    }
+
+    if (machines_[from].consumer != NONE) {
+        machines_[machines_[from].consumer].producer = NONE;
+    }
+
+    machines_[from].queue = &machines_[to].in;
+    machines_[from].consumer = to;
+    machines_[to].producer = from;
+}
+
+
+template<typename T, typename D>
+bool threadedScheduler<T, D>::push(size_t m, const T & val) {
+    return machines_[m].in.push(val);
+}
+
+
+template<typename T, typename D>
+template<typename F>
+size_t threadedScheduler<T, D>::drain(size_t m, F f) {
+    size_t n = 0;
+    T val;
+    while (machines_[m].out.pop(val)) {
+        f(val);
+        n++;
+    }
+
+    return n;
+}
+
+
+template<typename T, typename D>
+int threadedScheduler<T, D>::run() {
+    // starts a thread per machine that did not stop and waits until all of
+    // them are idle (a thread counts itself idle when it halts or parks, the
+    // thread waking it counts it busy again before it can run, so idle_
+    // reaching size() means no thread runs and none will be woken)
+    // -----------------
+
+    size_t stopped = 0;
+    for (const node & n: machines_) {
+        stopped += threadedScheduler::stopped(n);
+    }
+
+    idle_.store(stopped);
+    stop_.store(false);
+
+    std::vector<std::thread> threads;
+    threads.reserve(machines_.size() - stopped);
+    for (size_t m = 0; m < machines_.size(); m++) {
+        if (!threadedScheduler::stopped(machines_[m])) {
+            threads.emplace_back(&threadedScheduler::work, this, m);
+        }
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(doneMu_);
+        doneCv_.wait(lock, [this]{ return idle_.load() == machines_.size(); });
+    }
+
+    stop_.store(true);
+    for (node & n: machines_) {
+        std::lock_guard<std::mutex> lock(n.mu);
+        n.cv.notify_one();
+    }
+
+    for (std::thread & t: threads) { t.join(); }
+
+    size_t halted = 0;
+    bool limited = false;
+    bool blocked = false;
+    for (node & n: machines_) {
+        n.sleeping.store(false);
+        halted += n.halted && n.results.empty();
+        limited = limited || n.limited;
+        blocked = blocked || n.waitOut;
+    }
+
+    if (halted == machines_.size()) {
+        return HALTED;
+    }
+
+    return limited ? LIMITED : blocked ? DEADLOCK : IDLE;
+}
+
+
+// --- PRIVATE ---
+
+template<typename T, typename D>
+void threadedScheduler<T, D>::work(size_t m) {
+    // thread of machine m, returns when the machine halted or stands at its
+    // instruction limit, or run() stops the parked threads
+    // -----------------
+
+    node & n = machines_[m];
+    T val;
+
+    while (true) {
+        if (!n.halted && !n.limited) {
+            bool moved = false;
+            while (!n.local.full() && n.in.pop(val)) {
+                n.local.push(val);
+                moved = true;
+            }
+            if (moved && n.producer != NONE) { wake(n.producer); }
+
+            n.halted = n.vm.runIntCode(n.local, n.results);
+            n.limited = !n.halted && n.vm.isAtLimit();
+        }
+
+        while (!n.results.empty()) {
+            if (n.queue->push(n.results.front())) {
+                n.results.pop(val);
+                continue;
+            }
+
+            if (n.consumer != NONE) { wake(n.consumer); }
+            n.waitOut = true;
+            if (!park(n, [&n]{ return !n.queue->full(); })) { return; }
+            n.waitOut = false;
+        }
+        if (n.consumer != NONE) { wake(n.consumer); }
+
+        if (n.halted || n.limited) {
+            becomeIdle();
+            return;
+        }
+
+        if (n.local.empty() &&
+            !park(n, [&n]{ return !n.in.empty(); })) { return; }
+    }
+}
+
+
+template<typename T, typename D>
+template<typename C>
+bool threadedScheduler<T, D>::park(node & n, C ready) {
+    // spin, then yield, then sleep until ready() or stop_. The sleeper
+    // publishes sleeping before it checks ready() a last time, the waker
+    // publishes its value before it checks sleeping, the fences make sure
+    // at least one of them sees the other
+    // -----------------
+
+    for (unsigned i = 0; i < SPINS; i++) {
+        if (ready()) { return true; }
+    }
+    for (unsigned i = 0; i < YIELDS; i++) {
+        if (ready()) { return true; }
+        std::this_thread::yield();
+    }
+
+    std::unique_lock<std::mutex> lock(n.mu);
+    while (!ready()) {
+        n.sleeping.store(true);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (ready()) {
+            n.sleeping.store(false);
+            return true;
+        }
+
+        parks_++;
+        becomeIdle();
+        n.cv.wait(lock, [&]{ return !n.sleeping.load() || stop_.load(); });
+        if (n.sleeping.load()) { return false; } // stopped while idle
+    }
+
+    return true;
+}
+
+
+template<typename T, typename D>
+void threadedScheduler<T, D>::wake(size_t m) {
+    // counts m busy again (on its behalf) before notifying it
+    node & n = machines_[m];
+
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!n.sleeping.load()) { return; }
+
+    std::lock_guard<std::mutex> lock(n.mu);
+    if (n.sleeping.load()) {
+        n.sleeping.store(false);
+        idle_--;
+        n.cv.notify_one();
+    }
+}
+
+
+template<typename T, typename D>
+void threadedScheduler<T, D>::becomeIdle() {
+    if (++idle_ == machines_.size()) {
+        std::lock_guard<std::mutex> lock(doneMu_);
+        doneCv_.notify_one();
+    }
+}
+
+
+#endif // THREADEDSCHEDULER_HPP
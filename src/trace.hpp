@@ -0,0 +1,399 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+#include <stdexcept>
+
+#include "intCode.hpp"
+#include "channel.hpp"
+
+
+/*
+Records the execution of an intCode (all inputs, all outputs and a checkpoint
+of the machine every interval instructions) so that any point of the run can
+be revisited later without running the program from the start: seek(count)
+restores the last checkpoint at or before count and re-executes at most
+interval instructions with the recorded inputs.
+
+Checkpoints are snapshots of the machine (copy-on-write, see
+intCode::fork()), so taking one costs O(1) and later only the memory pages
+written afterwards are duplicated. save() writes the trace to a compact
+binary stream (variable-length integers, every checkpoint stores only the
+memory words that differ from the previous one), load() reads it back.
+
+The machine is driven through channels (see intCode::runIntCode(channel<T>
+&, channel<T> &)), the stopAtInput/stopAtOutput settings of the recorded
+machine do not apply.
+
+--- CONSTRUCTOR ---
+
+# trace(const intCode<T, D> & vm, size_t interval = 1 << 16)
+- Arguments:
+    vm - machine to record (copied), instruction count 0 of the trace is its
+         current state
+    interval - number of instructions between checkpoints
+
+
+--- FUNCTIONS ---
+
+# void push(const T & val)
+- passes val to the recorded machine (input)
+
+# bool run()
+- runs the recorded machine until it halts or waits for an input that was
+  not pushed yet
+- Returns:
+    true IFF the program was halted
+
+# intCode<T, D> seek(size_t count) const
+- Returns:
+    the machine after count instructions of the recorded run (or at the end
+    of the recording, if it is shorter)
+
+# const std::vector<T> & getInputs() const,
+  const std::vector<T> & getOutputs() const,
+  size_t getInstructionCount() const
+- all inputs pushed, all outputs and the number of instructions recorded
+
+# void save(std::ostream & out) const, static trace load(std::istream & in)
+- binary trace format, version 2: "ICTR", version, sizeof(T), interval, the
+  instruction count, inputs, outputs, the number of checkpoints, the image
+  size of the first one and the checkpoints (instruction count, number of
+  inputs consumed, pos, relative base, memory size, changed words). Both
+  only touch the memory pages that were written (a far address costs one
+  page, not the address range). load() throws std::runtime_error for
+  anything else
+*/
+
+template<typename T, typename D = threadedDispatch>
+class trace {
+    public:
+        // Ctor
+        trace() = delete;
+        explicit trace(const intCode<T, D> & vm, size_t interval = 1 << 16) :
+                vm_(vm), interval_(interval), base_(vm.getInstructionCount()),
+                fed_(0), in_(1), out_(256)
+        {
+            checkpoint();
+        }
+
+        // Getters
+        const std::vector<T> & getInputs() const { return inputs_; }
+        const std::vector<T> & getOutputs() const { return outputs_; }
+        size_t getInstructionCount() const {
+            return vm_.getInstructionCount() - base_;
+        }
+
+        // Public Member
+        void push(const T & val) { inputs_.push_back(val); }
+        bool run();
+        intCode<T, D> seek(size_t) const;
+        void save(std::ostream &) const;
+        static trace load(std::istream &);
+
+    private:
+        struct point {
+            size_t count; // instructions executed before the checkpoint
+            size_t consumed; // inputs consumed before the checkpoint
+            intCode<T, D> vm;
+        };
+
+        intCode<T, D> vm_;
+        size_t interval_;
+        size_t base_; // instruction count of vm_ at the start
+        size_t fed_; // inputs passed to in_ so far
+        channel<T> in_;
+        channel<T> out_;
+        std::vector<T> inputs_;
+        std::vector<T> outputs_;
+        std::vector<point> points_;
+
+        // Private Member
+        intCode<T, D> replay(size_t, size_t &) const;
+        void checkpoint();
+        static void put(std::ostream &, uint64_t);
+        static uint64_t get(std::istream &);
+        static uint64_t zigzag(T val) {
+            return (uint64_t(val) << 1) ^ uint64_t(int64_t(val) >> 63);
+        }
+        static T unzigzag(uint64_t val) {
+            return T(int64_t(val >> 1) ^ -int64_t(val & 1));
+        }
+
+        // Static Constants
+        static const int VERSION = 2;
+        static const size_t PAGE_SIZE = pagedMemory<T>::PAGE_SIZE;
+};
+
+
+// ------------------------
+// --- MEMBER FUNCTIONS ---
+// ------------------------
+
+// --- PUBLIC ---
+
+template<typename T, typename D>
+bool trace<T, D>::run() {
+    // runs in slices of at most interval_ instructions, a checkpoint is taken
+    // after every full slice. in_ holds one input at a time so that the
+    // number of inputs consumed is known at every checkpoint
+    // -----------------
+
+    while (true) {
+        if (in_.empty() && fed_ < inputs_.size()) {
+            in_.push(inputs_[fed_++]);
+        }
+
+        size_t count = getInstructionCount();
+        size_t next = points_.back().count + interval_;
+        vm_.setInstructionLimit(next - count);
+
+        bool halted = vm_.runIntCode(in_, out_);
+        size_t n = out_.drain([&](const T & val) { outputs_.push_back(val); });
+
+        if (halted) {
+            return true;
+        }
+        if (getInstructionCount() == next) {
+            checkpoint();
+        } else if (n == 0 && in_.empty() && fed_ == inputs_.size()) {
+            return false; // waits for input
+        }
+    }
+}
+
+
+template<typename T, typename D>
+intCode<T, D> trace<T, D>::seek(size_t count) const {
+    size_t consumed;
+    return replay(std::min(count, getInstructionCount()), consumed);
+}
+
+
+template<typename T, typename D>
+void trace<T, D>::save(std::ostream & out) const {
+    out.write("ICTR", 4);
+    put(out, VERSION);
+    put(out, sizeof(T));
+    put(out, interval_);
+    put(out, getInstructionCount());
+
+    put(out, inputs_.size());
+    for (const T & val: inputs_) { put(out, zigzag(val)); }
+    put(out, outputs_.size());
+    for (const T & val: outputs_) { put(out, zigzag(val)); }
+
+    // memory of each checkpoint as (address gap, value) of the words that
+    // changed since the previous one. Only pages written since (not shared
+    // with the previous checkpoint) are compared, the memory is never copied
+    put(out, points_.size());
+    put(out, points_[0].vm.getImageSize());
+    for (size_t i = 0; i < points_.size(); i++) {
+        const intCode<T, D> & vm = points_[i].vm;
+
+        std::unordered_map<size_t, const T *> prevPages;
+        if (i > 0) {
+            points_[i-1].vm.forEachPage([&](size_t num, const T * cells) {
+                prevPages[num] = cells;
+            });
+        }
+
+        std::vector<std::pair<size_t, T>> changed;
+        vm.forEachPage([&](size_t num, const T * cells) {
+            auto prev = prevPages.find(num);
+            if (prev != prevPages.end() && prev->second == cells) { return; }
+
+            for (size_t j = 0; j < PAGE_SIZE; j++) {
+                T old = prev != prevPages.end() ? prev->second[j] : 0;
+                if (cells[j] != old) {
+                    changed.push_back({num * PAGE_SIZE + j, cells[j]});
+                }
+            }
+        });
+        std::sort(changed.begin(), changed.end());
+
+        put(out, points_[i].count);
+        put(out, points_[i].consumed);
+        put(out, vm.getPosition());
+        put(out, zigzag(vm.getRelativeBase()));
+        put(out, vm.getMemorySize());
+        put(out, changed.size());
+        size_t last = 0;
+        for (const auto & word: changed) {
+            put(out, word.first - last);
+            put(out, zigzag(word.second));
+            last = word.first;
+        }
+    }
+}
+
+
+template<typename T, typename D>
+trace<T, D> trace<T, D>::load(std::istream & in) {
+    char magic[4];
+    in.read(magic, 4);
+    if (!in || std::string(magic, 4) != "ICTR" || get(in) != VERSION ||
+        get(in) != sizeof(T))
+    {
+        throw std::runtime_error("trace::load(): not a version 2 trace of "
+                                 "this integer type");
+    }
+
+    size_t interval = get(in);
+    size_t count = get(in);
+
+    std::vector<T> inputs(get(in));
+    for (T & val: inputs) { val = unzigzag(get(in)); }
+    std::vector<T> outputs(get(in));
+    for (T & val: outputs) { val = unzigzag(get(in)); }
+
+    // the first checkpoint is built on its image, every other one on a copy
+    // of the previous one (sharing the pages it did not change)
+    std::vector<point> points;
+    size_t n = get(in);
+    size_t imageSize = get(in);
+    for (size_t i = 0; i < n; i++) {
+        size_t pointCount = get(in);
+        size_t consumed = get(in);
+        size_t pos = get(in);
+        T relBase = unzigzag(get(in));
+        size_t size = get(in);
+        size_t changed = get(in);
+
+        std::vector<std::pair<size_t, T>> words(changed);
+        size_t addr = 0;
+        for (auto & word: words) {
+            addr += get(in);
+            if (addr >= size) {
+                throw std::runtime_error("trace::load(): corrupt checkpoint");
+            }
+            word = {addr, unzigzag(get(in))};
+        }
+
+        if (points.empty()) {
+            std::vector<T> image(std::min(imageSize, size), 0);
+            for (const auto & word: words) {
+                if (word.first < image.size()) {
+                    image[word.first] = word.second;
+                }
+            }
+            points.push_back(point{pointCount, consumed,
+                                   intCode<T, D>(image)});
+        } else {
+            points.push_back(point{pointCount, consumed,
+                                   points.back().vm.fork()});
+        }
+
+        intCode<T, D> & vm = points.back().vm;
+        for (const auto & word: words) {
+            if (word.first >= vm.getImageSize() || i > 0) {
+                vm.patch(word.first, word.second);
+            }
+        }
+        if (size > 0 && vm.getMemorySize() < size) {
+            vm.patch(size-1, vm.getMemory(size-1));
+        }
+        vm.setPosition(pos, relBase);
+    }
+
+    if (!in || points.empty()) {
+        throw std::runtime_error("trace::load(): truncated trace");
+    }
+
+    // replays from the last checkpoint to the end of the recording, the
+    // loaded trace can continue recording from there
+    trace res(points.back().vm, interval);
+    res.points_ = points;
+    res.inputs_ = inputs;
+    res.outputs_ = outputs;
+    res.vm_ = res.replay(count, res.fed_);
+    res.base_ = res.vm_.getInstructionCount() - count;
+
+    return res;
+}
+
+
+// --- PRIVATE ---
+
+template<typename T, typename D>
+intCode<T, D> trace<T, D>::replay(size_t count, size_t & consumed) const {
+    // restores the last checkpoint at or before count and re-executes the
+    // recorded inputs from there. consumed is set to the number of inputs
+    // the returned machine has read in total
+
+    size_t lo = 0;
+    size_t hi = points_.size();
+    while (hi - lo > 1) {
+        size_t mid = (lo + hi) / 2;
+        if (points_[mid].count <= count) { lo = mid; }
+        else { hi = mid; }
+    }
+    const point & p = points_[lo];
+
+    intCode<T, D> vm = p.vm.fork();
+    channel<T> in(inputs_.size() - p.consumed);
+    channel<T> out(1);
+    for (size_t i = p.consumed; i < inputs_.size(); i++) {
+        in.push(inputs_[i]);
+    }
+
+    size_t start = vm.getInstructionCount();
+    size_t todo = count - p.count;
+
+    while (vm.getInstructionCount() - start < todo) {
+        vm.setInstructionLimit(todo - (vm.getInstructionCount() - start));
+        if (vm.runIntCode(in, out)) { break; }
+        if (out.empty() && in.empty()) { break; }
+        out.clear();
+    }
+
+    vm.setInstructionLimit(size_t(-1));
+    consumed = inputs_.size() - in.size();
+    return vm;
+}
+
+
+template<typename T, typename D>
+void trace<T, D>::checkpoint() {
+    points_.push_back(point{getInstructionCount(), fed_ - in_.size(),
+                            vm_.snapshot()});
+}
+
+
+template<typename T, typename D>
+void trace<T, D>::put(std::ostream & out, uint64_t val) {
+    // LEB128: 7 bits per byte, high bit set if more bytes follow
+
+    while (val >= 0x80) {
+        out.put(char((val & 0x7f) | 0x80));
+        val >>= 7;
+    }
+    out.put(char(val));
+}
+
+
+template<typename T, typename D>
+uint64_t trace<T, D>::get(std::istream & in) {
+    uint64_t val = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int c = in.get();
+        if (c == EOF) {
+            throw std::runtime_error("trace::load(): truncated trace");
+        }
+        val |= uint64_t(c & 0x7f) << shift;
+        if (!(c & 0x80)) { break; }
+    }
+
+    return val;
+}
+
+
+#endif // TRACE_HPP
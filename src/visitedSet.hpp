@@ -0,0 +1,135 @@
+#ifndef VISITEDSET_HPP
+#define VISITEDSET_HPP
+
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+
+/*
+Set of machine states seen by a search, stored as their 64-bit state hashes
+(see intCode::getStateHash()). A search forking machines for different input
+sequences (e.g. the droid of day 15) inserts every machine it reaches and
+drops the ones that were already there: equal states behave identically on
+the same inputs, so exploring them again cannot find anything new.
+
+The hashes are kept in an open-addressing table (linear probing, at most
+half full, doubled when it gets fuller), so insert() and contains() cost O(1)
+and no node is allocated per state. State hashes are already uniformly
+distributed, the low bits serve as the slot index directly. Two different
+states share a hash with probability 2^-64 (about 3e-8 for a million states
+in total); such a state would be dropped as seen.
+
+--- CONSTRUCTOR ---
+
+# visitedSet(size_t capacity = 1024)
+- Arguments:
+    capacity - number of states the table holds before it grows for the
+               first time
+
+
+--- FUNCTIONS ---
+
+# bool insert(uint64_t hash), template<typename M> bool insert(const M & vm)
+- Returns:
+    true if the state (hash, or that of machine vm) was new, false if it was
+    in the set already
+
+# bool contains(uint64_t hash) const, size_t size() const, void clear()
+*/
+
+class visitedSet {
+    public:
+        // Ctor
+        explicit visitedSet(size_t capacity = 1024) : size_(0), zero_(false) {
+            size_t n = 2;
+            while (n < 2*capacity) { n <<= 1; }
+            slots_.resize(n, 0);
+        }
+
+        // Getters
+        size_t size() const { return size_ + zero_; }
+
+        // Public Member
+        bool insert(uint64_t);
+        template<typename M> bool insert(const M & vm) {
+            return insert(vm.getStateHash());
+        }
+        bool contains(uint64_t) const;
+        void clear() {
+            std::fill(slots_.begin(), slots_.end(), 0);
+            size_ = 0;
+            zero_ = false;
+        }
+
+    private:
+        std::vector<uint64_t> slots_; // 0: empty
+        size_t size_; // hashes != 0 in slots_
+        bool zero_; // hash 0 (cannot be stored in a slot) is in the set
+
+        // Private Member
+        void grow();
+};
+
+
+// ------------------------
+// --- MEMBER FUNCTIONS ---
+// ------------------------
+
+// --- PUBLIC ---
+
+inline bool visitedSet::insert(uint64_t hash) {
+    if (hash == 0) {
+        bool fresh = !zero_;
+        zero_ = true;
+        return fresh;
+    }
+
+    size_t mask = slots_.size() - 1;
+    size_t i = hash & mask;
+    while (slots_[i] != 0) {
+        if (slots_[i] == hash) { return false; }
+        i = (i+1) & mask;
+    }
+
+    slots_[i] = hash;
+    size_++;
+    if (2*size_ > slots_.size()) { grow(); }
+
+    return true;
+}
+
+
+inline bool visitedSet::contains(uint64_t hash) const {
+    if (hash == 0) { return zero_; }
+
+    size_t mask = slots_.size() - 1;
+    for (size_t i = hash & mask; slots_[i] != 0; i = (i+1) & mask) {
+        if (slots_[i] == hash) { return true; }
+    }
+
+    return false;
+}
+
+
+// --- PRIVATE ---
+
+inline void visitedSet::grow() {
+    // doubles the table and inserts every hash again
+
+    std::vector<uint64_t> old(2*slots_.size(), 0);
+    old.swap(slots_);
+
+    size_t mask = slots_.size() - 1;
+    for (uint64_t hash: old) {
+        if (hash == 0) { continue; }
+        size_t i = hash & mask;
+        while (slots_[i] != 0) { i = (i+1) & mask; }
+        slots_[i] = hash;
+    }
+}
+
+
+#endif // VISITEDSET_HPP